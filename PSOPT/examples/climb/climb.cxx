@@ -42,6 +42,10 @@ struct Constants {
   DMatrix* ttab;
   DMatrix* ptab;
   DMatrix* gtab;
+  CubicSpline* CLa_spline;
+  CubicSpline* CD0_spline;
+  CubicSpline* eta_spline;
+  LookupTable2D* T_lookup;
 };
 
 typedef struct Constants Constants_;
@@ -120,10 +124,10 @@ void dae(adouble* derivatives, adouble* path, adouble* states,
   adouble CL_a, CD0, eta, T;
 
 
-  spline_interpolation( &CL_a, M, M1, CLa_table,  lM1);
-  spline_interpolation( &CD0,  M, M1, CD0_table, lM1);
-  spline_interpolation( &eta,  M, M1, eta_table, lM1);
-  spline_2d_interpolation(&T, M, h, M2, h1, T_table, workspace);
+  CL_a = CONSTANTS.CLa_spline->Evaluate(M);
+  CD0  = CONSTANTS.CD0_spline->Evaluate(M);
+  eta  = CONSTANTS.eta_spline->Evaluate(M);
+  T    = CONSTANTS.T_lookup->Evaluate(M, h);
 
 //  smooth_linear_interpolation( &CL_a, M, M1, CLa_table,  lM1);
 //  smooth_linear_interpolation( &CD0,  M, M1, CD0_table, lM1);
@@ -342,6 +346,18 @@ int main(void)
    CONSTANTS.ptab       = &ptab;
    CONSTANTS.gtab       = &gtab;
 
+   CubicSpline CLa_spline( M1, CLa_table );
+   CubicSpline CD0_spline( M1, CD0_table );
+   CubicSpline eta_spline( M1, eta_table );
+
+   CONSTANTS.CLa_spline = &CLa_spline;
+   CONSTANTS.CD0_spline = &CD0_spline;
+   CONSTANTS.eta_spline = &eta_spline;
+
+   LookupTable2D T_lookup( M2, h1, T_table, "spline" );
+
+   CONSTANTS.T_lookup   = &T_lookup;
+
    double h0     = 0.0;
    double hf     = 65600.0;
    double v0     = 424.26;
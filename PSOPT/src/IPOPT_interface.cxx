@@ -36,6 +36,11 @@ e-mail:    v.m.becerra@ieee.org
 
 #ifdef USE_IPOPT
 
+#include "IpIpoptData.hpp"
+#include "IpIpoptCalculatedQuantities.hpp"
+#include "IpOrigIpoptNLP.hpp"
+#include "IpTNLPAdapter.hpp"
+
 // constructor
 IPOPT_PSOPT::IPOPT_PSOPT(Workspace *pr, void *user_data)
 {
@@ -92,6 +97,62 @@ bool IPOPT_PSOPT::intermediate_callback(AlgorithmMode mode,
                                        const IpoptData* ip_data,
                                        IpoptCalculatedQuantities* ip_cq)
 {
+    if (workspace->realtime_flag) {
+        // Real-time mode: record the time taken by each iteration, keep the best
+        // iterate found so far and stop when the wall clock deadline is reached.
+
+        double now = get_wall_clock_time();
+
+        DMatrix& iteration_times = *workspace->realtime_iteration_times;
+
+        if ( iter>0 && workspace->realtime_niter < length(iteration_times) ) {
+             workspace->realtime_niter++;
+             iteration_times( workspace->realtime_niter ) = now - workspace->realtime_last;
+        }
+
+        workspace->realtime_last = now;
+
+        if (mode == RegularMode) {
+            // Feasible iterates are preferred, then the lowest objective among them. If no
+            // feasible iterate has been found, the least infeasible one is kept.
+            bool feasible = ( inf_pr <= workspace->algorithm->nlp_tolerance );
+            bool better;
+
+            if (!workspace->realtime_best_found)
+                 better = true;
+            else if (feasible)
+                 better = ( !workspace->realtime_best_feasible || obj_value < workspace->realtime_best_obj );
+            else
+                 better = ( !workspace->realtime_best_feasible && inf_pr < workspace->realtime_best_inf );
+
+            // The current iterate is only accessible through the internal IPOPT objects
+            OrigIpoptNLP* orignlp = dynamic_cast<OrigIpoptNLP*>( GetRawPtr( ip_cq->GetIpoptNLP() ) );
+            TNLPAdapter*  tnlp_adapter = NULL;
+
+            if (orignlp != NULL) {
+                 tnlp_adapter = dynamic_cast<TNLPAdapter*>( GetRawPtr( orignlp->nlp() ) );
+            }
+
+            if ( better && tnlp_adapter != NULL ) {
+                 workspace->realtime_best_x->Resize( workspace->nvars, 1 );
+                 tnlp_adapter->ResortX( *ip_data->curr()->x(), workspace->realtime_best_x->GetPr() );
+                 workspace->realtime_best_found    = true;
+                 workspace->realtime_best_feasible = feasible;
+                 workspace->realtime_best_obj      = obj_value;
+                 workspace->realtime_best_inf      = inf_pr;
+            }
+        }
+
+        if ( now - workspace->realtime_start >= workspace->algorithm->realtime_deadline ) {
+             workspace->realtime_deadline_reached = true;
+             return false;
+        }
+    }
+
+    if ( workspace->cancel_flag && workspace->cancel_flag->load() ) {
+         return false;
+    }
+
     return check_no_cancel(_user_data);
 }
 
@@ -115,22 +176,51 @@ bool IPOPT_PSOPT::get_nlp_info(Index& n, Index& m, Index& nnz_jac_g,
   DMatrix *X0 = workspace->x0;
   double  *x  = X0->GetPr();
 
-  if( !useAutomaticDifferentiation(*workspace->algorithm) ) {
+  // The fixed-size kernels are used if they match the current mesh and options
 
+  FixedSizeEvaluator* fixed_size = workspace->problem->fixed_size;
 
-     DetectJacobianSparsity(gg_num, *X0, m,  &nnzA,  workspace->iArow, workspace->jAcol, workspace->jac_Aij,
-                                             &nnzG,  workspace->iGrow, workspace->jGcol,
-                                             workspace->grw, workspace );
+  workspace->fixed_size_active = ( fixed_size != NULL && fixed_size->compatible(workspace) );
 
-     nnz = nnzA+nnzG;
+  if ( workspace->nlp_structure_done ) {
+     // The tapes, sparsity patterns and index groups found in a previous call
+     // for the current mesh are still valid, so they are reused.
+
+     nnz_jac_g = workspace->jac_nnz;
+
+     if( useAutomaticDifferentiation(*workspace->algorithm) && workspace->algorithm->hessian!="limited-memory" )
+          nnz_h_lag = workspace->hess_nnz;
+     else
+          nnz_h_lag = (int) ((n*n)+n)/2;
+
+     index_style = TNLP::C_STYLE;
+
+     return true;
+  }
+
+  if ( workspace->fixed_size_active ) {
+
+     nnz = fixed_size->jacobian_nnz();
+
+     workspace->jac_nnz = nnz;
 
      jsratio = (double) ((double)  nnz/((double) (n*m)));
 
-     if (jsratio > workspace->algorithm->jac_sparsity_ratio)
-     {
-           sprintf(workspace->text, "increase algorithm.jac_sparsity_ratio to just above %f", jsratio);
-           error_message(workspace->text);
-     }
+     sprintf(workspace->text,"\nJacobian structure given by the fixed-size kernels:");
+     psopt_print(workspace,workspace->text);
+     sprintf(workspace->text,"\n%i nonzero elements out of %i [ratio=%f]\n", nnz, n*m, jsratio);
+     psopt_print(workspace,workspace->text);
+
+  }
+
+  if( !workspace->fixed_size_active && !useAutomaticDifferentiation(*workspace->algorithm) ) {
+
+
+     DetectJacobianSparsity(gg_num, *X0, m,  &nnzA, &nnzG, workspace->grw, workspace );
+
+     nnz = nnzA+nnzG;
+
+     jsratio = (double) ((double)  nnz/((double) (n*m)));
 
      sprintf(workspace->text,"\nJacobian sparsity detected numerically:");
      psopt_print(workspace,workspace->text);
@@ -141,11 +231,24 @@ bool IPOPT_PSOPT::get_nlp_info(Index& n, Index& m, Index& nnz_jac_g,
      sprintf(workspace->text,"\n*** %i nonzero elements are not constant", nnzG );
      psopt_print(workspace,workspace->text);
 
+     getIndexGroups( workspace->igroup, m, n, nnzG, workspace->iGrow, workspace->jGcol, workspace);
+
 
   }
 
 
-  if( useAutomaticDifferentiation(*workspace->algorithm) ) {
+  if( !workspace->fixed_size_active && useAutomaticDifferentiation(*workspace->algorithm) ) {
+
+	// Arrays from a previous mesh are released, as ADOL-C allocates them
+	// with the size of the new sparsity pattern when called with repeat=0
+
+	if (workspace->jac_rind)      free(workspace->jac_rind);
+	if (workspace->jac_cind)      free(workspace->jac_cind);
+	if (workspace->jac_ad_values) free(workspace->jac_ad_values);
+
+	workspace->jac_rind      = NULL;
+	workspace->jac_cind      = NULL;
+	workspace->jac_ad_values = NULL;
 
 	unsigned int *jac_rind  = NULL;
 	unsigned int *jac_cind  = NULL;
@@ -181,22 +284,27 @@ bool IPOPT_PSOPT::get_nlp_info(Index& n, Index& m, Index& nnz_jac_g,
 #endif
 
 
+	reserve_jacobian_storage(nnz, workspace);
+
 	for(i=0;i<nnz;i++)
 	{
 		workspace->jGcol[i] = jac_cind[i];
 		workspace->iGrow[i] = jac_rind[i];
 	}
 
+	// Keep the arrays so that later calls to sparse_jac() can reuse the
+	// sparsity pattern and seed matrix (repeat=1)
+
+	workspace->jac_rind      = jac_rind;
+	workspace->jac_cind      = jac_cind;
+	workspace->jac_ad_values = jac_values;
+	workspace->jac_nnz       = nnz;
+
         sprintf(workspace->text,"\nJacobian sparsity detected using ADOLC:");
         psopt_print(workspace,workspace->text);
 
         jsratio = (double) ((double)  nnz/((double) (n*m)));
 
-        if (jsratio > workspace->algorithm->jac_sparsity_ratio) {
-           sprintf(workspace->text, "increase algorithm.jac_sparsity_ratio to just above %f", jsratio);
-           error_message(workspace->text);
-        }
-
         sprintf(workspace->text,"\n%i nonzero elements out of %i [ratio=%f]\n", nnz, n*m, jsratio);
         psopt_print(workspace,workspace->text);
 
@@ -242,32 +350,53 @@ bool IPOPT_PSOPT::get_nlp_info(Index& n, Index& m, Index& nnz_jac_g,
     sparse_hess(workspace->tag_hess, n,0,x,&nnz_hess,&hess_ir, &hess_jc,&hess_values, options);
 #endif
 
+       reserve_hessian_storage(nnz_hess, workspace);
+
        for (i=0; i< nnz_hess; i++) {
 		workspace->hess_ir[i] = hess_ir[i];
 		workspace->hess_jc[i] = hess_jc[i];
        }
 
+       // Arrays allocated by ADOL-C using malloc()
+       free(hess_ir);
+       free(hess_jc);
+       free(hess_values);
+
        sprintf(workspace->text,"\nHessian sparsity detected using ADOLC:");
        psopt_print(workspace,workspace->text);
        double hsratio = (double) ((double)  nnz_hess/((double) (n*n)));
-       if (hsratio > workspace->algorithm->hess_sparsity_ratio) {
-            sprintf(workspace->text, "increase algorithm.hess_sparsity_ratio to just above %f", hsratio);
-            error_message(workspace->text);
-       }
 
        sprintf(workspace->text,"\n%i nonzero elements out of %i [ratio = %f] \n", nnz_hess, n*n, hsratio );
        psopt_print(workspace,workspace->text);
 
        nnz_h_lag = nnz_hess;
 
+       workspace->hess_nnz = nnz_hess;
+
   } // end if (autoderiv)
 
+  if( workspace->algorithm->hessian=="gauss-newton" ) {
+
+       int nnz_hess = gauss_newton_hessian_structure(x, workspace);
+
+       sprintf(workspace->text,"\nGauss-Newton Hessian sparsity detected using ADOLC:");
+       psopt_print(workspace,workspace->text);
+       double hsratio = (double) ((double)  nnz_hess/((double) (n*n)));
+
+       sprintf(workspace->text,"\n%i nonzero elements out of %i [ratio = %f] \n", nnz_hess, n*n, hsratio );
+       psopt_print(workspace,workspace->text);
+
+       nnz_h_lag = nnz_hess;
+
+       workspace->hess_nnz = nnz_hess;
+  }
+
     nnz_jac_g = nnz;
 
 
   // the hessian is in this case assumed to be a square dense matrix but we
   // only need the lower left corner (since it is symmetric)
-  if( !useAutomaticDifferentiation(*workspace->algorithm) || workspace->algorithm->hessian!="exact" )
+  if( !useAutomaticDifferentiation(*workspace->algorithm) || workspace->algorithm->hessian=="limited-memory" )
         nnz_h_lag = (int) ((n*n)+n)/2;
 
 /*   *
@@ -280,6 +409,8 @@ bool IPOPT_PSOPT::get_nlp_info(Index& n, Index& m, Index& nnz_jac_g,
   // use the C style indexing (0-based)
   index_style = TNLP::C_STYLE;
 
+  workspace->nlp_structure_done = true;
+
   return true;
 }
 
@@ -321,12 +452,9 @@ bool IPOPT_PSOPT::get_starting_point(Index n, bool init_x, Number* x,
                                    Index m, bool init_lambda,
                                    Number* lambda)
 {
-  // Here, we assume we only have starting values for x, if you code
-  // your own NLP, you can provide starting values for the dual variables
-  // if you wish
+  // Starting values for the dual variables are requested by IPOPT when
+  // warm starting (option warm_start_init_point = yes)
   assert(init_x == true);
-//  assert(init_z == false);
-//  assert(init_lambda == false);
 
   Index i;
 
@@ -339,9 +467,20 @@ bool IPOPT_PSOPT::get_starting_point(Index n, bool init_x, Number* x,
 	  x[i] = x0[i];
   }
 
-//  for (i=0; i<workspace->ncons;i++) {
-//	  lambda[i]=(*workspace->lambda)(i+1);
-//  }
+  if (init_lambda) {
+     for (i=0; i<workspace->ncons;i++) {
+	  lambda[i]=(*workspace->lambda)(i+1);
+     }
+  }
+
+  if (init_z) {
+     // Bound multipliers are only available if the previous NLP had the same size
+     bool z_available = ( length(*workspace->zl)==n && length(*workspace->zu)==n );
+     for (i=0; i<n; i++) {
+	  z_L[i] = z_available ? (*workspace->zl)(i+1) : 0.0;
+	  z_U[i] = z_available ? (*workspace->zu)(i+1) : 0.0;
+     }
+  }
 
   return true;
 }
@@ -353,6 +492,14 @@ bool IPOPT_PSOPT::eval_f(Index n, const Number* x, bool new_x, Number& obj_value
 
   DMatrix& X = *workspace->Xip;
 
+  if ( workspace->fixed_size_active ) {
+     obj_value = workspace->problem->fixed_size->objective(x, workspace);
+     if (workspace->enable_nlp_counters) {
+         workspace->solution->mesh_stats[ workspace->current_mesh_refinement_iteration-1 ].n_obj_evals++;
+     }
+     return true;
+  }
+
   memcpy( X.GetPr(), x, workspace->nvars*sizeof(double) );
 
   obj_value = ff_num(X, workspace);
@@ -369,6 +516,11 @@ bool IPOPT_PSOPT::eval_grad_f(Index n, const Number* x, bool new_x, Number* grad
 
   DMatrix& GF = *workspace->GFip;
 
+  if ( workspace->fixed_size_active ) {
+     workspace->problem->fixed_size->gradient(x, grad_f, workspace);
+     return true;
+  }
+
   memcpy( X.GetPr(), x, workspace->nvars*sizeof(double) );
 
   if(!useAutomaticDifferentiation(*workspace->algorithm))
@@ -392,6 +544,14 @@ bool IPOPT_PSOPT::eval_g(Index n, const Number* x, bool new_x, Index m, Number*
 
   DMatrix& G  = *workspace->Gip;
 
+  if ( workspace->fixed_size_active ) {
+     workspace->problem->fixed_size->constraints(x, g, workspace);
+     if (workspace->enable_nlp_counters) {
+         workspace->solution->mesh_stats[ workspace->current_mesh_refinement_iteration-1 ].n_con_evals++;
+     }
+     return true;
+  }
+
   memcpy( X.GetPr(), x, workspace->nvars*sizeof(double) );
 
   gg_num(X, &G, workspace);
@@ -410,7 +570,9 @@ void save_jacobian_sparsity_pattern(Index* rindex, Index* cindex, long nvars, lo
 
     FILE* jac_file;
 
-    jac_file = fopen("jacobian_pattern.dat", "w");
+    string fname = get_output_file_name(*workspace->algorithm, "jacobian_pattern.dat");
+
+    jac_file = fopen(fname.c_str(), "w");
 
     if (jac_file == NULL) {
          error_message("save_jacobian_sparsity_pattern(): error opening jacobian pattern file");
@@ -446,6 +608,19 @@ bool IPOPT_PSOPT::eval_jac_g(Index n, const Number* x, bool new_x,
   int nnzA, nnzG, i;
 
 
+  if ( workspace->fixed_size_active ) {
+    if (values == NULL) {
+       workspace->problem->fixed_size->jacobian_structure(iRow, jCol);
+    }
+    else {
+       workspace->problem->fixed_size->jacobian(x, values, workspace);
+       if (workspace->enable_nlp_counters) {
+          workspace->solution->mesh_stats[ workspace->current_mesh_refinement_iteration-1 ].n_jacobian_evals++;
+       }
+    }
+    return true;
+  }
+
   if (values == NULL) {
   // return the structure of the jacobian
     X = *workspace->x0;
@@ -456,9 +631,6 @@ bool IPOPT_PSOPT::eval_jac_g(Index n, const Number* x, bool new_x,
         nnzA = workspace->jac_nnzA;
         nnzG = workspace->jac_nnzG;
 
-
-        getIndexGroups( workspace->igroup, m, n, nnzG, workspace->iGrow, workspace->jGcol, workspace);
-
 	for (i=0;i<nnzG;i++)
 	{
 		iRow[i] = workspace->iGrow[i]-1;
@@ -511,8 +683,6 @@ bool IPOPT_PSOPT::eval_jac_g(Index n, const Number* x, bool new_x,
     if (useAutomaticDifferentiation(*workspace->algorithm)) {
 
     	int nnz = nele_jac;
-    	unsigned int *jac_rind = NULL;
-    	unsigned int *jac_cind = NULL;
 
 
 
@@ -520,17 +690,21 @@ bool IPOPT_PSOPT::eval_jac_g(Index n, const Number* x, bool new_x,
 		xpr[i] = x[i];
 	}
 
-        double* jac_values = NULL;
-
 
 #ifdef ADOLC_VERSION_1
+    	unsigned int *jac_rind = NULL;
+    	unsigned int *jac_cind = NULL;
+        double* jac_values = NULL;
 	sparse_jac(workspace->tag_g, m, n, 0, xpr, &nnz, &jac_rind, &jac_cind, &jac_values);
 #endif
 
 #ifdef ADOLC_VERSION_2
+    // The sparsity pattern and seed matrix computed by the call in get_nlp_info()
+    // are reused (repeat=1), together with the arrays allocated by ADOL-C.
     int options[4];
     options[0]=0; options[1]=0; options[2]=0; options[3]=0;
-	sparse_jac(workspace->tag_g, m, n, 0, xpr, &nnz, &jac_rind, &jac_cind, &jac_values, options);
+	sparse_jac((short) workspace->tag_g, m, n, 1, xpr, &nnz, &workspace->jac_rind, &workspace->jac_cind, &workspace->jac_ad_values, options);
+        double* jac_values = workspace->jac_ad_values;
 #endif
 
 	for(i=0;i<nnz;i++) {
@@ -570,6 +744,12 @@ void IPOPT_PSOPT::finalize_solution(SolverReturn status,
 
   memcpy( (workspace->lambda)->GetPr(), lambda, m*sizeof(double) );
 
+  workspace->zl->Resize(n,1);
+  workspace->zu->Resize(n,1);
+
+  memcpy( (workspace->zl)->GetPr(), z_L, n*sizeof(double) );
+  memcpy( (workspace->zu)->GetPr(), z_U, n*sizeof(double) );
+
   for(int ii=0;ii<n;ii++) solution->xad[ii]=x[ii];
 
 }
@@ -588,7 +768,7 @@ bool IPOPT_PSOPT::eval_h(Index n, const Number* x, bool new_x,
 
   int i;
 
-  if (workspace->algorithm->hessian!="exact")
+  if (workspace->algorithm->hessian=="limited-memory")
     return false;
 
  if (!useAutomaticDifferentiation(*workspace->algorithm) ) return false;
@@ -607,7 +787,23 @@ bool IPOPT_PSOPT::eval_h(Index n, const Number* x, bool new_x,
   else {
     // return the values of the Hessian
 
-    if (useAutomaticDifferentiation(*workspace->algorithm) && nele_hess>0) {
+    if (workspace->algorithm->hessian=="gauss-newton") {
+    	double *xpr = workspace->Xsnopt->GetPr();
+
+	for (i=0;i<n;i++) {
+		xpr[i] = x[i];
+	}
+
+	for(i=0;i<m;i++)
+		workspace->lambda_d[i] = lambda[i];
+
+	gauss_newton_hessian_values(xpr, obj_factor, workspace->lambda_d, m, values, workspace);
+
+	if (workspace->enable_nlp_counters) {
+	    workspace->solution->mesh_stats[ workspace->current_mesh_refinement_iteration-1 ].n_hessian_evals++;
+	}
+    }
+    else if (useAutomaticDifferentiation(*workspace->algorithm) && nele_hess>0) {
     	double *xpr = workspace->Xsnopt->GetPr();
 
 
@@ -654,6 +850,10 @@ bool IPOPT_PSOPT::eval_h(Index n, const Number* x, bool new_x,
              values[i] = hess_values[i];
         }
 
+        free(hess_ir);
+        free(hess_jc);
+        free(hess_values);
+
 	if (workspace->enable_nlp_counters) {
 	    workspace->solution->mesh_stats[ workspace->current_mesh_refinement_iteration-1 ].n_hessian_evals++;
 	}
@@ -99,6 +99,8 @@ void gg_ad( adouble* xad, adouble* gad, Workspace* workspace )
 
     int phase_offset  = 0;
 
+    begin_interpolation_cache(workspace);
+
     linkages = workspace->linkages;
 
     for(i=0;i< problem->nphases; i++)
@@ -375,6 +377,8 @@ void gg_ad( adouble* xad, adouble* gad, Workspace* workspace )
 	}
   }
 
+  end_interpolation_cache(workspace);
+
   if (workspace->enable_nlp_counters) {
          workspace->solution->mesh_stats[  workspace->current_mesh_refinement_iteration-1 ].n_con_evals++;
   }
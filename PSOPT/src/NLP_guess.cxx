@@ -252,13 +252,20 @@ void hot_start_nlp_guess(DMatrix& x0,DMatrix& lambda, Sol& solution,Prob& proble
 		(solution.nodes[i])(1,k)  =  convert_to_original_time( (workspace->snodes[i])(k), prev_t0(i+1), prev_tf(i+1) );
 	}
 
+	// Barycentric weights of the previous nodes, shared by all the interpolated trajectories
+	DMatrix prev_weights;
+
+	if (!use_local_collocation(algorithm)) {
+		pseudospectral_barycentric_weights(prev_nodes[i], prev_weights, algorithm);
+	}
+
 
 	// Interpolate states into new nodes
 	for (k=1;k<=nstates;k++) {
 
 		xp = (prev_states[i])(k,colon());
 		if (!use_local_collocation(algorithm) ) {
-		    lagrange_interpolation(xn,solution.nodes[i],prev_nodes[i], xp);
+		    lagrange_interpolation(xn,solution.nodes[i],prev_nodes[i], xp, prev_weights);
 		}
 		else {
 		    linear_interpolation(xn,solution.nodes[i],prev_nodes[i], xp, length(xp));
@@ -271,7 +278,7 @@ void hot_start_nlp_guess(DMatrix& x0,DMatrix& lambda, Sol& solution,Prob& proble
 	for (k=1;k<=nstates;k++) {
 		xp = (prev_costates[i])(k,colon());
 		if (!use_local_collocation(algorithm)) {
-		    lagrange_interpolation(xn,solution.nodes[i],prev_nodes[i], xp);
+		    lagrange_interpolation(xn,solution.nodes[i],prev_nodes[i], xp, prev_weights);
 		}
 		else {
 		    linear_interpolation(xn,solution.nodes[i],prev_nodes[i], xp, length(xp));
@@ -292,7 +299,7 @@ void hot_start_nlp_guess(DMatrix& x0,DMatrix& lambda, Sol& solution,Prob& proble
 		for (k=1;k<=npath;k++) {
 			pp = (prev_path[i])(k,colon());
 			if (!use_local_collocation(algorithm)) {
-			    lagrange_interpolation(pn,solution.nodes[i],prev_nodes[i], pp);
+			    lagrange_interpolation(pn,solution.nodes[i],prev_nodes[i], pp, prev_weights);
 			}
 			else {
 			    linear_interpolation(pn,solution.nodes[i],prev_nodes[i], pp, length(pp));
@@ -362,3 +369,191 @@ void hot_start_nlp_guess(DMatrix& x0,DMatrix& lambda, Sol& solution,Prob& proble
 }
 
 
+void shift_node_values(DMatrix& v, int offset, int nrows, int npoints, DMatrix& time, DMatrix& shifted_time, bool use_lagrange, const bool* linear_rows)
+{
+   // This function resamples at the shifted times the node values v(offset+(k-1)*nrows+j),
+   // j=1,...,nrows, k=1,...,npoints, which are defined at the given times. If linear_rows is
+   // not NULL, the rows j for which linear_rows[j-1] is true are interpolated linearly, so
+   // that their values do not overshoot those at the neighbouring nodes.
+
+   int j, k;
+
+   DMatrix yp(1,npoints);
+   DMatrix yn;
+   DMatrix w(1,npoints);
+
+   if (use_lagrange) {
+        barycentric_weights(time.GetPr(), w.GetPr(), npoints);
+   }
+
+   for (j=1; j<=nrows; j++) {
+
+        for (k=1; k<=npoints; k++) {
+             yp(k) = v(offset+(k-1)*nrows+j);
+        }
+
+        if (use_lagrange && !(linear_rows && linear_rows[j-1])) {
+             lagrange_interpolation(yn, shifted_time, time, yp, w);
+        }
+        else {
+             linear_interpolation(yn, shifted_time, time, yp, npoints);
+        }
+
+        for (k=1; k<=npoints; k++) {
+             v(offset+(k-1)*nrows+j) = yn(k);
+        }
+   }
+
+}
+
+
+void shift_nlp_guess(DMatrix& x0, DMatrix& lambda, Prob& problem, Alg& algorithm, DMatrix* initial_state, double shift, Workspace* workspace)
+{
+   // This function shifts forward in time by "shift" the NLP primal and dual solution
+   // stored in x0, lambda and the bound multipliers, so that it can be used to warm start
+   // the NLP after the time horizon of the problem has moved. The mesh is unchanged, and
+   // values beyond the previous final time are held constant. If initial_state is not NULL,
+   // it replaces the states at the first node of the first phase.
+
+   int i, k;
+   int x_phase_offset   = 0;
+   int lam_phase_offset = 0;
+
+   DMatrix& xlb = *workspace->xlb;
+   DMatrix& xub = *workspace->xub;
+   DMatrix& zl  = *workspace->zl;
+   DMatrix& zu  = *workspace->zu;
+
+   bool use_lagrange = !use_local_collocation(algorithm);
+
+   bool shift_bound_multipliers = ( length(zl)==workspace->nvars && length(zu)==workspace->nvars );
+
+   for(i=0; i<problem.nphases; i++)
+   {
+	DMatrix& state_scaling   = problem.phase[i].scale.states;
+        double   time_scaling    = problem.phase[i].scale.time;
+
+	int norder    = problem.phase[i].current_number_of_intervals;
+	int ncontrols = problem.phase[i].ncontrols;
+	int nstates   = problem.phase[i].nstates;
+        int nparam    = problem.phase[i].nparameters;
+	int nevents   = problem.phase[i].nevents;
+	int npath     = problem.phase[i].npath;
+	int offset1   = ncontrols*(norder+1);
+        int offset2   = (ncontrols+nstates)*(norder+1);
+        int offset;
+
+	int nvars_phase_i = get_nvars_phase_i(problem,i, workspace);
+        int ncons_phase_i = get_ncons_phase_i(problem,i, workspace);
+
+        int it0 = x_phase_offset + nvars_phase_i - 1;
+        int itf = x_phase_offset + nvars_phase_i;
+
+        double t0 = x0(it0)/time_scaling;
+        double tf = x0(itf)/time_scaling;
+        double ts;
+
+        DMatrix time(1,norder+1);
+        DMatrix shifted_time(1,norder+1);
+        DMatrix time_bar(1,norder);
+        DMatrix shifted_time_bar(1,norder);
+
+        for (k=1; k<=norder+1; k++) {
+             time(k)         = convert_to_original_time( (workspace->snodes[i])(k), t0, tf );
+             shifted_time(k) = MIN( MAX( time(k)+shift, t0 ), tf );
+        }
+
+        // Shift the controls and states, together with their bound multipliers. The bound
+        // multipliers are non-negative, and are interpolated linearly so that they do not
+        // overshoot below zero.
+
+        shift_node_values(x0, x_phase_offset, ncontrols, norder+1, time, shifted_time, false);
+        shift_node_values(x0, x_phase_offset+offset1, nstates, norder+1, time, shifted_time, use_lagrange);
+
+        if (shift_bound_multipliers) {
+             shift_node_values(zl, x_phase_offset, ncontrols, norder+1, time, shifted_time, false);
+             shift_node_values(zl, x_phase_offset+offset1, nstates, norder+1, time, shifted_time, false);
+             shift_node_values(zu, x_phase_offset, ncontrols, norder+1, time, shifted_time, false);
+             shift_node_values(zu, x_phase_offset+offset1, nstates, norder+1, time, shifted_time, false);
+        }
+
+        if ( need_midpoint_controls(algorithm, workspace) ) {
+
+             for (k=1; k<=norder; k++) {
+                  time_bar(k) = ( time(k)+time(k+1) )/2.0;
+             }
+
+             for (k=1; k<=norder; k++) {
+                  shifted_time_bar(k) = MIN( MAX( time_bar(k)+shift, time_bar(1) ), time_bar(norder) );
+             }
+
+             shift_node_values(x0, x_phase_offset+offset2+nparam, ncontrols, norder, time_bar, shifted_time_bar, false);
+
+             if (shift_bound_multipliers) {
+                  shift_node_values(zl, x_phase_offset+offset2+nparam, ncontrols, norder, time_bar, shifted_time_bar, false);
+                  shift_node_values(zu, x_phase_offset+offset2+nparam, ncontrols, norder, time_bar, shifted_time_bar, false);
+             }
+        }
+
+        // Move the initial and final times with the horizon if the new bounds allow it,
+        // otherwise keep the previous values clipped to the new bounds.
+
+        ts = x0(it0) + shift*time_scaling;
+        if ( ts >= xlb(it0) && ts <= xub(it0) )
+             x0(it0) = ts;
+        else
+             x0(it0) = MIN( MAX( x0(it0), xlb(it0) ), xub(it0) );
+
+        ts = x0(itf) + shift*time_scaling;
+        if ( ts >= xlb(itf) && ts <= xub(itf) )
+             x0(itf) = ts;
+        else
+             x0(itf) = MIN( MAX( x0(itf), xlb(itf) ), xub(itf) );
+
+        // Shift the Lagrange multipliers of the differential defects and path constraints.
+        // The multipliers of path constraints with a single finite bound have a fixed sign,
+        // and are interpolated linearly.
+
+        shift_node_values(lambda, lam_phase_offset, nstates, norder+1, time, shifted_time, use_lagrange);
+
+        offset = lam_phase_offset + nstates*(norder+1) + nevents;
+
+        if (npath>0) {
+             bool* one_sided = new bool[npath];
+             for (k=1; k<=npath; k++) {
+                  double plow  = (problem.phase[i].bounds.lower.path)(k);
+                  double phigh = (problem.phase[i].bounds.upper.path)(k);
+                  one_sided[k-1] = ( (plow == -INF) != (phigh == INF) );
+             }
+             shift_node_values(lambda, offset, npath, norder+1, time, shifted_time, use_lagrange, one_sided);
+             delete [] one_sided;
+        }
+
+        offset += npath*(norder+1);
+
+        if (npath>0 && need_midpoint_controls(algorithm, workspace) ) {
+             shift_node_values(lambda, offset, npath, norder, time_bar, shifted_time_bar, false);
+        }
+
+        // Replace the initial states with the measured ones
+
+        if (i==0 && initial_state != NULL) {
+             for (k=1; k<=nstates; k++) {
+                  x0(x_phase_offset+offset1+k) = (*initial_state)(k)*state_scaling(k);
+             }
+        }
+
+        x_phase_offset   += nvars_phase_i;
+        lam_phase_offset += ncons_phase_i;
+   }
+
+   if (shift_bound_multipliers) {
+        for (k=1; k<=workspace->nvars; k++) {
+             zl(k) = MAX( zl(k), 0.0 );
+             zu(k) = MAX( zu(k), 0.0 );
+        }
+   }
+
+}
+
+
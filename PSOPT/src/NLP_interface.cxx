@@ -33,7 +33,6 @@ e-mail:    v.m.becerra@ieee.org
 
 #ifdef USE_SNOPT
 #include "snoptProblem.hpp"
-Workspace* tempsnoptworkspace;
 #endif
 
 
@@ -65,22 +64,78 @@ int NLP_interface(
   // C++ interface to SNOPT.
   snoptProblemA snprob;
 
-  tempsnoptworkspace = workspace;
+  // The callback finds the workspace of this solve in the user array iu, so that
+  // independent solves do not share any global state.
+
+  int iu[ SNOPT_WORKSPACE_IU_LENGTH ];
+
+  set_snopt_user_workspace(iu, workspace);
 
   // Allocate and initialize. 
   int n     =  length(*x0);
   int neF   =  nlp_ncons+1;
 
-  int lenA  =  (nlp_ncons+1)*n;
+  // The constant (linear) and non-constant elements of the Jacobian of F = [f; g] are
+  // detected before calling SNOPT, so that the arrays passed to it hold exactly neA and
+  // neG elements instead of (nlp_ncons+1)*n.
+
+  int neA, neG;
+
+  workspace->JacCol1->Resize(neF,1);
+  workspace->JacCol2->Resize(neF,1);
+  workspace->JacCol3->Resize(neF,1);
+
+  DetectJacobianSparsity(fg_num, *x0, neF, &neA, &neG, workspace->grw, workspace );
+
+  workspace->JacCol1->Resize(nlp_ncons,1);
+  workspace->JacCol2->Resize(nlp_ncons,1);
+  workspace->JacCol3->Resize(nlp_ncons,1);
+
+  sprintf(workspace->text,"\nJacobian sparsity detected numerically:");
+  psopt_print(workspace,workspace->text);
+  sprintf(workspace->text,"\n*** %i constant and %i non-constant elements out of %li\n", neA, neG, ((long) neF)*n );
+  psopt_print(workspace,workspace->text);
+
+  int lenA  =  MAX(neA,1);
 
   int *iAfun = new int[lenA];
   int *jAvar = new int[lenA];
   double *A  = new double[lenA];
 
-  int lenG   = lenA;
+  int lenG   = MAX(neG,1);
   int *iGfun = new int[lenG];
   int *jGvar = new int[lenG];
 
+  for (int iA = 0; iA < neA; ++iA) {
+       iAfun[iA] = workspace->iArow[iA];
+       jAvar[iA] = workspace->jAcol[iA];
+       A[iA]     = workspace->jac_Aij[iA];
+  }
+
+  for (int iG = 0; iG < neG; ++iG) {
+       iGfun[iG] = workspace->iGrow[iG];
+       jGvar[iG] = workspace->jGcol[iG];
+  }
+
+  // DetectJacobianSparsity returns 1-based indices, which are kept for As and the
+  // Jacobian maps. snoptProblemA::solve() adds 1 to the indices it is given unless
+  // computeJac was called, so SNOPT is passed 0-based copies.
+
+  int *iAfun0 = new int[lenA];
+  int *jAvar0 = new int[lenA];
+  int *iGfun0 = new int[lenG];
+  int *jGvar0 = new int[lenG];
+
+  for (int iA = 0; iA < neA; ++iA) {
+       iAfun0[iA] = iAfun[iA]-1;
+       jAvar0[iA] = jAvar[iA]-1;
+  }
+
+  for (int iG = 0; iG < neG; ++iG) {
+       iGfun0[iG] = iGfun[iG]-1;
+       jGvar0[iG] = jGvar[iG]-1;
+  }
+
   double *x      = new double[n];
   double *xlow   = new double[n];
   double *xupp   = new double[n];
@@ -136,24 +191,21 @@ int NLP_interface(
   memcpy(x, x0->GetPr(), n*sizeof(double) );
 
   snprob.setProbName(problem->name.c_str());
-  snprob.setPrintFile("snopt.out");
+  snprob.setPrintFile( get_output_file_name(algorithm, "snopt.out").c_str() );
 
   snprob.setProblemSize(n, neF);
   snprob.setObjective(ObjRow, ObjAdd);
   snprob.setX(x, xlow, xupp, xmul, xstate);
   snprob.setF(F, Flow, Fupp, Fmul, Fstate);
   snprob.setUserFun(snPSOPTusrf_);
+  snprob.setUserI(iu, SNOPT_WORKSPACE_IU_LENGTH);
 
-  // snopta will compute the Jacobian by finite-differences.
-  int neA = -1;
-  int neG = -1;
-  snprob.setA(lenA, neA, iAfun, jAvar, A);
-  snprob.setG(lenG, neG, iGfun, jGvar);
+  snprob.setA(lenA, neA, iAfun0, jAvar0, A);
+  snprob.setG(lenG, neG, iGfun0, jGvar0);
 
   workspace->jac_done = 0;
 
-  // computeJac will determine sparsity and will set neA and neG.  
-  snprob.computeJac(neA, neG);
+  reserve_snopt_jacobian_storage(neG, workspace);
 
   for (int iG = 0; iG < neG; ++iG) {
     workspace->iGfun[iG] = (unsigned int) iGfun[iG];
@@ -179,6 +231,17 @@ int NLP_interface(
 	fgad[i] >>= fg[i];
      trace_off();
 
+     // Arrays from a previous mesh are released, as ADOL-C allocates them
+     // with the size of the new sparsity pattern
+
+     if (workspace->iGfun2) free(workspace->iGfun2);
+     if (workspace->jGvar2) free(workspace->jGvar2);
+     if (workspace->G2)     free(workspace->G2);
+
+     workspace->iGfun2 = NULL;
+     workspace->jGvar2 = NULL;
+     workspace->G2     = NULL;
+
 #ifdef ADOLC_VERSION_1
      sparse_jac(workspace->tag_fg, neF, n, 0, x, &workspace->F_nnz, &workspace->iGfun2, &workspace->jGvar2, &workspace->G2);
 #endif
@@ -195,19 +258,10 @@ int NLP_interface(
 
      double jsratio = (double) ((double)  workspace->F_nnz/((double) (n*neF)));
 
-     if (jsratio > workspace->algorithm->jac_sparsity_ratio) {
-           sprintf(workspace->text, "increase algorithm.jac_sparsity_ratio to just above %f", jsratio);
-           error_message(workspace->text);
-     }
-
      sprintf(workspace->text,"\n%i nonzero elements out of %li [ratio=%f]\n", workspace->F_nnz, n*neF, jsratio);
      psopt_print(workspace,workspace->text);
 
-
-      for (i=0;i<workspace->F_nnz;i++) {
-          	  workspace->iGfun1[i] = workspace->iGfun2[i]+1;
-        	  workspace->jGvar1[i] = workspace->jGvar2[i]+1;
-      }
+     map_snopt_jacobian_elements(neG, n, workspace);
 
   }
 
@@ -281,6 +335,11 @@ int NLP_interface(
 
   delete [] iGfun;
   delete [] jGvar;
+
+  delete [] iAfun0;
+  delete [] jAvar0;
+  delete [] iGfun0;
+  delete [] jGvar0;
   
   delete [] x;
   delete [] xlow;
@@ -294,9 +353,6 @@ int NLP_interface(
   delete [] Fmul;
   delete [] Fstate;
 
-  // TODO
-  tempsnoptworkspace = NULL;
-
 /*
 // ************* C INTERFACE ************************
   integer Cold = 0, Basis = 1, Warm = 2;
@@ -399,11 +455,6 @@ int NLP_interface(
 
      double jsratio = (double) ((double)  workspace->F_nnz/((double) (n*neF)));
 
-     if (jsratio > workspace->algorithm->jac_sparsity_ratio) {
-           sprintf(workspace->text, "increase algorithm.jac_sparsity_ratio to just above %f", jsratio);
-           error_message(workspace->text);
-     }
-
      sprintf(workspace->text,"\n%i nonzero elements out of %li [ratio=%f]\n", workspace->F_nnz, n*neF, jsratio);
      psopt_print(workspace,workspace->text);
 
@@ -553,12 +604,12 @@ int NLP_interface(
   // Change some options
   app->Options()->SetNumericValue("tol", workspace->algorithm->nlp_tolerance );
   app->Options()->SetStringValue("mu_strategy", "adaptive");
-  app->Options()->SetStringValue("output_file", "ipopt.out");
+  app->Options()->SetStringValue("output_file", get_output_file_name(algorithm, "ipopt.out"));
   app->Options()->SetStringValue("nlp_scaling_method","gradient-based");
   app->Options()->SetNumericValue("max_cpu_time", workspace->algorithm->ipopt_max_cpu_time );
 
 
-  if ( useAutomaticDifferentiation(algorithm) && algorithm.hessian=="exact" ) {
+  if ( useAutomaticDifferentiation(algorithm) && algorithm.hessian!="limited-memory" ) {
      app->Options()->SetStringValue("hessian_approximation", "exact");
   }
   else {
@@ -572,7 +623,12 @@ int NLP_interface(
       app->Options()->SetIntegerValue("print_level", 5);
   }
 
-  app->Options()->SetIntegerValue("max_iter", workspace->algorithm->nlp_iter_max);
+  if (workspace->realtime_flag) {
+     app->Options()->SetIntegerValue("max_iter", workspace->algorithm->realtime_iter_max);
+  }
+  else {
+     app->Options()->SetIntegerValue("max_iter", workspace->algorithm->nlp_iter_max);
+  }
   if (hotflag) {
      app->Options()->SetStringValue("warm_start_init_point", "yes");
   }
@@ -588,9 +644,48 @@ int NLP_interface(
     return (int) status;
   }
 
+  if (workspace->realtime_flag) {
+     workspace->realtime_deadline_reached = false;
+     workspace->realtime_best_found       = false;
+     workspace->realtime_niter            = 0;
+     workspace->realtime_iteration_times->Resize( workspace->algorithm->realtime_iter_max+1, 1 );
+     workspace->realtime_start            = get_wall_clock_time();
+     workspace->realtime_last             = workspace->realtime_start;
+  }
+
   // Ask Ipopt to solve the problem
   status = app->OptimizeTNLP(mynlp);
 
+  if (workspace->realtime_flag) {
+     // Return the best iterate found unless IPOPT has converged, together with a status flag
+
+     if ( status == Solve_Succeeded || status == Solved_To_Acceptable_Level ) {
+          solution->realtime_status = REALTIME_CONVERGED;
+     }
+     else {
+          if (workspace->realtime_deadline_reached)
+               solution->realtime_status = REALTIME_DEADLINE_REACHED;
+          else if (status == Maximum_Iterations_Exceeded)
+               solution->realtime_status = REALTIME_ITERATION_LIMIT;
+          else
+               solution->realtime_status = REALTIME_NLP_FAILED;
+
+          if (workspace->realtime_best_found) {
+               *x0 = *workspace->realtime_best_x;
+               for(i=0;i<workspace->nvars;i++) solution->xad[i] = (*x0)(i+1);
+          }
+     }
+
+     solution->realtime_iterations = workspace->realtime_niter;
+
+     if (workspace->realtime_niter>0) {
+          solution->iteration_times = (*workspace->realtime_iteration_times)( colon(1, workspace->realtime_niter) );
+     }
+     else {
+          solution->iteration_times.Resize(0,0);
+     }
+  }
+
   if (status == Solve_Succeeded) {
     psopt_print(workspace,"\n\n*** The problem has been solved!\n");
   }
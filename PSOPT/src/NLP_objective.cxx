@@ -64,6 +64,8 @@ adouble ff_ad(adouble* xad, Workspace* workspace)
 
     sum_cost = 0.0;
 
+    begin_interpolation_cache(workspace);
+
     for(i=0;i<problem.nphases;i++)
     {
         int iphase = i+1;
@@ -210,6 +212,8 @@ adouble ff_ad(adouble* xad, Workspace* workspace)
 
     }
 
+    end_interpolation_cache(workspace);
+
     if (problem.scale.objective != -1)
     {
 	retval = sum_cost*problem.scale.objective;
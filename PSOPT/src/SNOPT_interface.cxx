@@ -33,9 +33,25 @@ e-mail:    v.m.becerra@ieee.org
 
 #ifdef USE_SNOPT
 
-static Workspace* workspace= NULL; // Temporary measure to get this file to compile.
-                                      // Consider changing to C++ interface to see if
-                                      // the same thing as IPOPT can be done with workspace.
+void set_snopt_user_workspace(int* iu, Workspace* workspace)
+{
+  // Stores the workspace pointer in the integer user array passed to SNOPT
+
+  memcpy( iu, &workspace, sizeof(Workspace*) );
+}
+
+static Workspace* get_snopt_user_workspace(int* iu, int leniu)
+{
+  Workspace* workspace = NULL;
+
+  if ( leniu < SNOPT_WORKSPACE_IU_LENGTH ) {
+      error_message("snPSOPTusrf_(): the SNOPT user array does not hold a workspace");
+  }
+
+  memcpy( &workspace, iu, sizeof(Workspace*) );
+
+  return workspace;
+}
 
 void snPSOPTusrf_(int    *Status, int *n,    double x[],
 	     int    *needF,  int *neF,  double F[],
@@ -46,7 +62,7 @@ void snPSOPTusrf_(int    *Status, int *n,    double x[],
 
 {
 
-  workspace = tempsnoptworkspace;
+  Workspace* workspace = get_snopt_user_workspace(iu, *leniu);
 
   Alg& algorithm    = *workspace->algorithm;
 
@@ -57,6 +73,11 @@ void snPSOPTusrf_(int    *Status, int *n,    double x[],
 
   int i;
 
+  if ( workspace->cancel_flag && workspace->cancel_flag->load() ) {
+       // Ask SNOPT to terminate the solve
+       *Status = -2;
+       return;
+  }
 
   memcpy( X.GetPr(), x, (*n)*sizeof(double) );
 
@@ -107,23 +128,26 @@ void snPSOPTusrf_(int    *Status, int *n,    double x[],
 
         double *xvars = X.GetPr();
 
+        // The sparsity pattern found in NLP_interface() for the current mesh is reused (repeat=1),
+        // so the triplets keep the order assumed by workspace->G_map.
+
 #ifdef ADOLC_VERSION_1
-	sparse_jac(workspace->tag_fg, nF, nvars, 0, xvars, &workspace->F_nnz, &workspace->iGfun2, &workspace->jGvar2, &workspace->G2);
+	sparse_jac(workspace->tag_fg, nF, nvars, 1, xvars, &workspace->F_nnz, &workspace->iGfun2, &workspace->jGvar2, &workspace->G2);
 #endif
 
 #ifdef ADOLC_VERSION_2
     int options[4];
     options[0]=0; options[1]=0; options[2]=0;options[3]=0;
-	sparse_jac(workspace->tag_fg, nF, nvars, 0, xvars, &workspace->F_nnz, &workspace->iGfun2, &workspace->jGvar2, &workspace->G2, options);
+	sparse_jac(workspace->tag_fg, nF, nvars, 1, xvars, &workspace->F_nnz, &workspace->iGfun2, &workspace->jGvar2, &workspace->G2, options);
 
 #endif
 
-        SparseMatrix GS2(workspace->G2, nF, nvars, workspace->F_nnz, (int*) workspace->iGfun1, (int*) workspace->jGvar1);
-
+        // Gather the result into G[] in the order expected by SNOPT.
+        int*    G_map = workspace->G_map;
+        double* G2    = workspace->G2;
 
-        // Copy the result into G[] using the right indices to send it back to SNOPT.
         for(k=0;k<(*neG);k++) {
-               G[k] = GS2(workspace->iGfun[k],workspace->jGvar[k]);
+               G[k] = ( G_map[k]>=0 ) ? G2[ G_map[k] ] : 0.0;
         }
 
         if (workspace->enable_nlp_counters) {
@@ -167,6 +191,78 @@ void fg_ad( adouble* x, adouble* fg, Workspace* workspace)
 }
 
 
+void map_snopt_jacobian_elements(int neG, int nvars, Workspace* workspace)
+{
+   // Finds, for each element (iGfun[k], jGvar[k]) of SNOPT's G, its position in the Jacobian
+   // triplets of F computed by ADOL-C, or -1 if ADOL-C does not report it. The map is built
+   // once per mesh, after which G is filled by a single gather in snPSOPTusrf_().
+
+   int j, k, p;
+
+   int nnz = workspace->F_nnz;
+
+   unsigned int* rind = workspace->iGfun2;
+   unsigned int* cind = workspace->jGvar2;
+
+   // Triplets grouped by column
+
+   int* colstart = new int[nvars+1];
+   int* bucket   = new int[MAX(nnz,1)];
+
+   for(j=0; j<=nvars; j++) colstart[j] = 0;
+
+   for(p=0; p<nnz; p++) colstart[ cind[p]+1 ]++;
+
+   for(j=0; j<nvars; j++) colstart[j+1] += colstart[j];
+
+   int* next = new int[nvars];
+
+   for(j=0; j<nvars; j++) next[j] = colstart[j];
+
+   for(p=0; p<nnz; p++) bucket[ next[ cind[p] ]++ ] = p;
+
+   for(k=0; k<neG; k++) {
+
+        int irow = (int) workspace->iGfun[k]-1;
+        int jcol = (int) workspace->jGvar[k]-1;
+
+        workspace->G_map[k] = -1;
+
+        for(p=colstart[jcol]; p<colstart[jcol+1]; p++) {
+             if ( (int) rind[ bucket[p] ] == irow ) {
+                  workspace->G_map[k] = bucket[p];
+                  break;
+             }
+        }
+   }
+
+   delete [] colstart;
+   delete [] bucket;
+   delete [] next;
+}
+
+
+void fg_num( DMatrix& x, DMatrix* fg, Workspace* workspace )
+{
+   // Objective followed by the constraints, the function vector F passed to SNOPT
+
+   int j;
+
+   DMatrix& g = *workspace->gsnopt;
+
+   fg->Resize( workspace->ncons+1, 1 );
+
+   (*fg)(1) = ff_num( x, workspace );
+
+   gg_num( x, &g, workspace );
+
+   for(j=1; j<=workspace->ncons; j++)
+   {
+        (*fg)(j+1) = g(j);
+   }
+
+}
+
 
 #endif // USE_SNOPT
 
@@ -473,10 +473,10 @@ void EfficientlyComputeJacobianNonZeros( void fun(DMatrix& x, DMatrix* f, Worksp
 
 
 void DetectJacobianSparsity(void fun(DMatrix& x, DMatrix* f, Workspace* ), DMatrix& x, int nf,
-                           int* nnzA, int* iArow, int* jAcol, double* Aij,
-                           int* nnzG, int* jGrow, int* jGcol,
-                           GRWORK* grw, Workspace* workspace)
+                           int* nnzA, int* nnzG, GRWORK* grw, Workspace* workspace)
 {
+  // The constant elements are stored in workspace->iArow, jAcol and jac_Aij, and the
+  // non-constant elements in workspace->iGrow and jGcol. The arrays are grown as needed.
 
 
 
@@ -519,6 +519,22 @@ void DetectJacobianSparsity(void fun(DMatrix& x, DMatrix* f, Workspace* ), DMatr
 
 
 
+      int ncol_nz = 0;
+
+      for(i=1; i<=nf; i++) {
+            if ( ( fabs(JacCol1(i,1)) +  fabs(JacCol2(i,1)) + fabs(JacCol3(i,1)) )>=tol ) {
+                 ncol_nz++;
+            }
+      }
+
+      reserve_jacobian_storage( MAX(nzcount_A, nzcount_G) + ncol_nz, workspace );
+
+      int*    iArow = workspace->iArow;
+      int*    jAcol = workspace->jAcol;
+      double* Aij   = workspace->jac_Aij;
+      int*    jGrow = workspace->iGrow;
+      int*    jGcol = workspace->jGcol;
+
       for(i=1; i<=nf; i++) {
             if ( ( fabs(JacCol1(i,1)) +  fabs(JacCol2(i,1)) + fabs(JacCol3(i,1)) )>=tol ) {
               if ( fabs(JacCol1(i,1)-JacCol2(i,1))<=tol && fabs(JacCol1(i,1)-JacCol3(i,1))<=tol ) {
@@ -633,36 +649,129 @@ void ScalarGradientAD( adouble (*fun)(adouble *, Workspace*), DMatrix& x, DMatri
 }
 
 
-void compute_jacobian_of_constraints_with_respect_to_variables(DMatrix& Jc, DMatrix& X, DMatrix& XL, DMatrix& XU, Workspace* workspace)
+static void difference_steps(double xj, double xlj, double xuj, double* hp, double* hm)
+// Steps used to difference with respect to a variable, as in JacobianColumn(): a central
+// difference away from the bounds, otherwise a one sided difference (one of the steps is zero).
+{
+    double sqreps = sqrt( DMatrix::GetEPS() );
+    double delj   = sqreps*(1.+fabs(xj));
+
+    if ((xj < xuj-delj && xj > xlj+delj) || (xuj==xlj)) {
+        *hp = delj;  *hm = delj;
+    }
+    else if (xj >= xuj-delj) {
+        *hp = 0.0;   *hm = delj;
+    }
+    else {
+        *hp = delj;  *hm = 0.0;
+    }
+}
+
+
+static int get_active_constraint_rows(int* row_map, Workspace* workspace)
+// Maps the NLP constraints onto the rows of the constraint Jacobian used for the parameter
+// statistics: the differential defects and the active inequality constraints of each phase.
+// The constraint tf>=t0 of each phase is discarded. row_map[i] is set to the new row index
+// of constraint i (0-based), or -1 if the constraint is discarded. Returns the number of rows.
+{
+   Prob& problem  = *workspace->problem;
+   DMatrix& lambda = *workspace->lambda;
+
+   int ncons = get_number_nlp_constraints(problem, workspace);
+
+   int i, j, iphase;
+
+   int icount = 0;
+
+   int lam_phase_offset = 0;
+
+   for(i=0;i<ncons;i++) row_map[i] = -1;
+
+   for(iphase=1;iphase<=problem.nphases;iphase++) {
+       int ncons_phase_i =  get_ncons_phase_i(problem,iphase-1, workspace);
+       int nstates = problem.phases(iphase).nstates;
+       int norder  = problem.phases(iphase).current_number_of_intervals;
+       for(j=1;j<=ncons_phase_i;j++) {
+           i = lam_phase_offset + j;
+           if (j<= nstates*(norder+1)) {
+              row_map[i-1] = icount++;
+           }
+           else if( j< ncons_phase_i && lambda(i)!=0.0 ) {
+              row_map[i-1] = icount++;
+           }
+       }
+       lam_phase_offset+= ncons_phase_i;
+   }
+
+   return icount;
+}
+
+
+static void color_jacobian_columns(const cs* J, int* color, int* ncolors)
+// Greedy partition of the columns of the sparsity pattern J into groups of columns
+// without common rows, which can be differenced together (Curtis, Powell and Reid, 1974).
+{
+   int i, j, j2, p, q, c;
+
+   cs* JT = cs_transpose(J, 0);
+
+   int* mark = new int[J->n+1];
+
+   for(j=0;j<J->n;j++) { color[j] = -1; mark[j] = -1; }
+   mark[J->n] = -1;
+
+   *ncolors = 0;
+
+   for(j=0;j<J->n;j++) {
+      for(p=J->p[j];p<J->p[j+1];p++) {
+         i = J->i[p];
+         for(q=JT->p[i];q<JT->p[i+1];q++) {
+            j2 = JT->i[q];
+            if (color[j2]>=0) mark[color[j2]] = j;
+         }
+      }
+      for(c=0; mark[c]==j; c++);
+      color[j] = c;
+      if (c+1 > *ncolors) *ncolors = c+1;
+   }
+
+   delete [] mark;
+   cs_spfree(JT);
+}
+
+
+cs* compute_sparse_jacobian_of_active_constraints(DMatrix& X, DMatrix& XL, DMatrix& XU, Workspace* workspace)
 {
+    // Returns in compressed column form the Jacobian of the unscaled constraints with respect to
+    // the NLP variables, with the rows given by get_active_constraint_rows(). With automatic
+    // differentiation the Jacobian is found by ADOL-C. Otherwise, if the sparsity pattern
+    // detected for the NLP solver is available, the columns are differenced in groups,
+    // else column by column.
 
     Alg& algorithm = *workspace->algorithm;
     Prob& problem  = *workspace->problem;
 
-    int i, j, l, k;
+    int i, j, k, p, c;
 
     int nvars = get_number_nlp_vars(problem, workspace);
 
     int ncons = get_number_nlp_constraints(problem, workspace);
 
-    DMatrix Jctmp(ncons,nvars);
+    int* row_map = new int[ncons];
+
+    int nrows = get_active_constraint_rows(row_map, workspace);
 
-    Jc.Resize(ncons,nvars);
+    DMatrix& xp = *workspace->xp;
 
-    DMatrix& JacCol1 = *workspace->JacCol1;
-    DMatrix& xlb     = *workspace->xlb;
-    DMatrix& xub     = *workspace->xub;
-    DMatrix& xp      = *workspace->xp;
-    DMatrix jtemp;
+    cs* T = cs_spalloc(nrows, nvars, MAX(workspace->jac_nnz, 1), 1, 1);
 
     workspace->use_constraint_scaling = 0;
 
-     xp = X;
-//     clip_vector_given_bounds( xp, xlb, xub);
+    xp = X;
 
-     if ( useAutomaticDifferentiation(algorithm) ) {
+    if ( useAutomaticDifferentiation(algorithm) ) {
 
-    unsigned int *jac_rind  = NULL;
+	unsigned int *jac_rind  = NULL;
 	unsigned int *jac_cind  = NULL;
 	double       *jac_values = NULL;
 	int           nnz;
@@ -688,92 +797,186 @@ void compute_jacobian_of_constraints_with_respect_to_variables(DMatrix& Jc, DMat
 #endif
 
 #ifdef ADOLC_VERSION_2
-    int options[4];
-    options[0]=0; options[1]=0; options[2]=0;options[3]=0;
+        int options[4];
+        options[0]=0; options[1]=0; options[2]=0;options[3]=0;
 	sparse_jac(workspace->tag_gc, ncons, nvars, 0, x, &nnz, &jac_rind, &jac_cind, &jac_values, options);
 #endif
 
-    for(j=0;j<nvars;j++)
-    {
-       Jctmp( jac_rind[j]+1, jac_cind[j]+1) = jac_values[j];
-    }
+        for(k=0;k<nnz;k++) {
+           if ( row_map[jac_rind[k]] >= 0 ) cs_entry(T, row_map[jac_rind[k]], jac_cind[k], jac_values[k]);
+        }
 
+        // Arrays allocated by ADOL-C using malloc()
+        free(jac_rind);
+        free(jac_cind);
+        free(jac_values);
 
-   }
-   else {
+    }
+    else if ( workspace->nlp_structure_done && !workspace->fixed_size_active && workspace->jac_nnz>0 ) {
 
-    	DMatrix& xlb = *(workspace->xlb);
-	    DMatrix& xub = *(workspace->xub);
-	    for(j=1;j<=nvars;j++) {
-	      JacobianColumn( gg_num, xp, xlb, xub,j, &JacCol1, workspace->grw, workspace);
-	      Jctmp(colon(),j) = JacCol1;
-	    }
+        // Pattern of the constant and non-constant elements detected for the NLP solver
 
-   } // end if-else
+        cs* P = cs_spalloc(ncons, nvars, workspace->jac_nnz, 1, 1);
 
+        for(k=0;k<workspace->jac_nnzG;k++) cs_entry(P, workspace->iGrow[k]-1, workspace->jGcol[k]-1, 1.0);
+        for(k=0;k<workspace->jac_nnzA;k++) cs_entry(P, workspace->iArow[k]-1, workspace->jAcol[k]-1, 1.0);
 
-   DMatrix& lambda = *workspace->lambda;
+        cs* J = cs_compress(P);
+        cs_spfree(P);
+        cs_dupl(J);
 
-   int icount=1;
+        int  ncolors;
+        int* color = new int[nvars];
+        double* hp = new double[nvars];
+        double* hm = new double[nvars];
 
-   int lam_phase_offset=0;
+        color_jacobian_columns(J, color, &ncolors);
 
-   int iphase;
+        for(j=0;j<nvars;j++) difference_steps(X(j+1), XL(j+1), XU(j+1), &hp[j], &hm[j]);
 
-   for(iphase=1;iphase<=problem.nphases;iphase++) {
-       int ncons_phase_i =  get_ncons_phase_i(problem,iphase-1, workspace);
-       for(j=1;j<=ncons_phase_i;j++) {
-           int nstates = problem.phases(iphase).nstates;
-           int norder  = problem.phases(iphase).current_number_of_intervals;
-           i = lam_phase_offset + j;
-           if (j<= nstates*(norder+1)) {
-           // Copy rows corresponding to differential defect constraints.
-              for (k=1;k<=nvars;k++) {
-                    Jc(icount,k) = Jctmp(i,k);
+        DMatrix F1(ncons,1), F2(ncons,1), xm(nvars,1);
+
+        for(c=0;c<ncolors;c++) {
+           xp = X;
+           xm = X;
+           for(j=0;j<nvars;j++) {
+              if (color[j]==c) {
+                 xp(j+1) += hp[j];
+                 xm(j+1) -= hm[j];
               }
-              icount++;
            }
-           else if( j< ncons_phase_i) { // discard constraint tf>=t0 for each phase
-              if ( lambda(i)!=0.0 ) {
-                // Only copy rows corresponding to active inequality constraints.
-                 for (k=1;k<=nvars;k++) {
-                    Jc(icount,k) = Jctmp(i,k);
-                 }
-                 icount++;
+           gg_num(xp, &F1, workspace);
+           gg_num(xm, &F2, workspace);
+           for(j=0;j<nvars;j++) {
+              if (color[j]!=c) continue;
+              for(p=J->p[j];p<J->p[j+1];p++) {
+                 i = J->i[p];
+                 if (row_map[i] >= 0) cs_entry(T, row_map[i], j, (F1(i+1)-F2(i+1))/(hp[j]+hm[j]));
               }
            }
-       }
-       lam_phase_offset+= ncons_phase_i;
-   }
+        }
+
+        delete [] color;
+        delete [] hp;
+        delete [] hm;
+        cs_spfree(J);
+
+    }
+    else {
+
+        DMatrix& JacCol1 = *workspace->JacCol1;
+
+        JacCol1.Resize(ncons,1);
+
+        for(j=1;j<=nvars;j++) {
+            JacobianColumn( gg_num, xp, XL, XU, j, &JacCol1, workspace->grw, workspace);
+            for(i=0;i<ncons;i++) {
+                if ( row_map[i]>=0 && JacCol1(i+1)!=0.0 ) cs_entry(T, row_map[i], j-1, JacCol1(i+1));
+            }
+        }
+
+    }
 
-   Jc = Jc(colon(1,icount-1), colon());
+    workspace->use_constraint_scaling = 1;
 
-   workspace->use_constraint_scaling = 1;
+    delete [] row_map;
 
+    cs* Jc = cs_compress(T);
+
+    cs_spfree(T);
+
+    cs_dupl(Jc);
+
+    return Jc;
 }
 
 
-void compute_jacobian_of_residual_vector_with_respect_to_variables(DMatrix& Jr, DMatrix& X, DMatrix& XL, DMatrix& XU, Workspace* workspace)
+cs* compute_sparse_jacobian_of_residual_vector(DMatrix& X, DMatrix& XL, DMatrix& XU, Workspace* workspace)
 {
-    DMatrix Jcol;
-	Prob & problem = *(workspace->problem);
-    int nvar, nr, iphase, pindex, j;
+    // Returns in compressed column form the Jacobian of the residual vector with respect to the
+    // NLP variables. With automatic differentiation the Jacobian is found from the taped residual
+    // function. Otherwise, as the residuals of each phase only depend on the variables of that
+    // phase, the j-th variable of every phase is perturbed at the same time, and the number of
+    // evaluations of the residual vector is given by the largest number of variables in a phase.
 
-	nvar = get_number_nlp_vars(problem, workspace);
+    Prob & problem = *(workspace->problem);
 
-	nr    = 0;
+    int nvar, nr, iphase, i, j, g, ngroups;
 
-	for(iphase=1; iphase<=problem.nphases;iphase++)
-	{
-	  nr    += problem.phases(iphase).nobserved*problem.phases(iphase).nsamples;
-	}
+    nvar = get_number_nlp_vars(problem, workspace);
 
-	Jr.Resize(nr,nvar);
-	Jcol.Resize(nr,1);
+    if ( useAutomaticDifferentiation(*workspace->algorithm) ) {
 
+        nr = get_number_of_residuals(problem);
 
-	for(j=1;j<=nvar;j++) {
-	    JacobianColumn( rr_num, X, XL, XU, j, &Jcol, workspace->grw, workspace);
-	    Jr(colon(),j) = Jcol;
-	}
+        DMatrix xp = X;
+
+        int nnz = compute_sparse_residual_jacobian(xp.GetPr(), NULL, workspace);
+
+        cs* T = cs_spalloc(nr, nvar, MAX(nnz,1), 1, 1);
+
+        for(i=0;i<nnz;i++) {
+            cs_entry(T, workspace->res_jac_rind[i], workspace->res_jac_cind[i], workspace->res_jac_values[i]);
+        }
+
+        cs* Jr = cs_compress(T);
+
+        cs_spfree(T);
+
+        return Jr;
+    }
+
+    int* var_offset = new int[problem.nphases];
+    int* nvar_phase = new int[problem.nphases];
+    int* res_offset = new int[problem.nphases+1];
+
+    nr      = 0;
+    ngroups = 0;
+
+    for(iphase=1; iphase<=problem.nphases;iphase++)
+    {
+        var_offset[iphase-1] = get_iphase_offset(problem, iphase, workspace);
+        nvar_phase[iphase-1] = get_nvars_phase_i(problem, iphase-1, workspace);
+        res_offset[iphase-1] = nr;
+        nr     += problem.phases(iphase).nobserved*problem.phases(iphase).nsamples;
+        ngroups = MAX(ngroups, nvar_phase[iphase-1]);
+    }
+    res_offset[problem.nphases] = nr;
+
+    cs* T = cs_spalloc(nr, nvar, MAX(nr,1), 1, 1);
+
+    DMatrix F1(nr,1), F2(nr,1), xp(nvar,1), xm(nvar,1);
+    DMatrix hp(problem.nphases,1), hm(problem.nphases,1);
+
+    for(g=0; g<ngroups; g++) {
+        xp = X;
+        xm = X;
+        for(iphase=1; iphase<=problem.nphases;iphase++) {
+            if (g >= nvar_phase[iphase-1]) continue;
+            j = var_offset[iphase-1] + g + 1;
+            difference_steps(X(j), XL(j), XU(j), &hp(iphase), &hm(iphase));
+            xp(j) += hp(iphase);
+            xm(j) -= hm(iphase);
+        }
+        rr_num(xp, &F1, workspace);
+        rr_num(xm, &F2, workspace);
+        for(iphase=1; iphase<=problem.nphases;iphase++) {
+            if (g >= nvar_phase[iphase-1]) continue;
+            j = var_offset[iphase-1] + g;
+            for(i=res_offset[iphase-1]; i<res_offset[iphase]; i++) {
+                double dfdx = (F1(i+1)-F2(i+1))/(hp(iphase)+hm(iphase));
+                if (dfdx != 0.0) cs_entry(T, i, j, dfdx);
+            }
+        }
+    }
+
+    delete [] var_offset;
+    delete [] nvar_phase;
+    delete [] res_offset;
+
+    cs* Jr = cs_compress(T);
+
+    cs_spfree(T);
+
+    return Jr;
 }
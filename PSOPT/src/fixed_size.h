@@ -0,0 +1,502 @@
+/*********************************************************************************************
+
+This file is part of the PSOPT library, a software tool for computational optimal control
+
+Copyright (C) 2009-2020 Victor M. Becerra
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA,
+or visit http://www.gnu.org/licenses/
+
+Author:    Professor Victor M. Becerra
+Address:   University of Portsmouth
+           School of Energy and Electronic Engineering
+           Portsmouth PO1 3DJ
+           United Kingdom
+e-mail:    v.m.becerra@ieee.org
+
+**********************************************************************************************/
+
+#ifndef __FIXED_SIZE_H__
+#define __FIXED_SIZE_H__
+
+// Compile-time fixed-size evaluation kernels for small single phase problems.
+//
+// The number of states NS, controls NC, nodes NN and events NE are template
+// parameters, so that the objective, constraints and their derivatives are
+// evaluated with stack arrays and loops of constant length, without ADOL-C
+// tapes. The problem functions are supplied once as static member templates
+// of a Model class, which are instantiated with double, adouble and FixedDual:
+//
+//   struct Model {
+//      template<class T> static void dae(T* derivatives, const T* states, const T* controls, const T& time);
+//      template<class T> static T    integrand_cost(const T* states, const T* controls, const T& time);
+//      template<class T> static T    endpoint_cost(const T* initial_states, const T* final_states, const T& t0, const T& tf);
+//      template<class T> static void events(T* e, const T* initial_states, const T* final_states, const T& t0, const T& tf);
+//   };
+//
+// The problem is then set up as usual, using the static adaptors of
+// FixedSizeProblem<NS,NC,NN,NE,Model> as the PSOPT problem functions, and the
+// kernels are activated by pointing problem.fixed_size to an instance of it.
+// The kernels are used by the IPOPT interface whenever the current mesh and
+// options match the template parameters (single phase, no parameters, path
+// constraints or linkages, pseudospectral collocation with NN nodes); otherwise
+// the general path is used. NC and NE may be zero, the arrays sized by them have one
+// extra element.
+
+
+// Forward mode dual number with a fixed number N of directional derivatives
+
+template<int N>
+class FixedDual {
+public:
+   double v;
+   double d[N];
+
+   FixedDual()                { v = 0.0; for (int i=0;i<N;i++) d[i] = 0.0; }
+   FixedDual(double a)        { v = a;   for (int i=0;i<N;i++) d[i] = 0.0; }
+
+   double value() const       { return v; }
+
+   // Define this dual number as the independent variable number i
+   void seed(double a, int i) { v = a;   for (int j=0;j<N;j++) d[j] = 0.0; d[i] = 1.0; }
+
+   FixedDual& operator+=(const FixedDual& b) { v += b.v; for (int i=0;i<N;i++) d[i] += b.d[i]; return *this; }
+   FixedDual& operator-=(const FixedDual& b) { v -= b.v; for (int i=0;i<N;i++) d[i] -= b.d[i]; return *this; }
+   FixedDual& operator*=(const FixedDual& b) { for (int i=0;i<N;i++) d[i] = d[i]*b.v + v*b.d[i]; v *= b.v; return *this; }
+   FixedDual& operator/=(const FixedDual& b) { double r = 1.0/b.v; for (int i=0;i<N;i++) d[i] = (d[i] - v*r*b.d[i])*r; v *= r; return *this; }
+   FixedDual& operator+=(double b)           { v += b; return *this; }
+   FixedDual& operator-=(double b)           { v -= b; return *this; }
+   FixedDual& operator*=(double b)           { v *= b; for (int i=0;i<N;i++) d[i] *= b; return *this; }
+   FixedDual& operator/=(double b)           { double r = 1.0/b; v *= r; for (int i=0;i<N;i++) d[i] *= r; return *this; }
+};
+
+// Applies the chain rule for a function with value fv and derivative df at a.v
+
+template<int N> inline FixedDual<N> fd_chain(const FixedDual<N>& a, double fv, double df)
+{ FixedDual<N> r; r.v = fv; for (int i=0;i<N;i++) r.d[i] = df*a.d[i]; return r; }
+
+template<int N> inline FixedDual<N> operator+(const FixedDual<N>& a) { return a; }
+template<int N> inline FixedDual<N> operator-(const FixedDual<N>& a) { return fd_chain(a, -a.v, -1.0); }
+
+template<int N> inline FixedDual<N> operator+(FixedDual<N> a, const FixedDual<N>& b) { return a += b; }
+template<int N> inline FixedDual<N> operator-(FixedDual<N> a, const FixedDual<N>& b) { return a -= b; }
+template<int N> inline FixedDual<N> operator*(FixedDual<N> a, const FixedDual<N>& b) { return a *= b; }
+template<int N> inline FixedDual<N> operator/(FixedDual<N> a, const FixedDual<N>& b) { return a /= b; }
+
+template<int N> inline FixedDual<N> operator+(FixedDual<N> a, double b) { return a += b; }
+template<int N> inline FixedDual<N> operator-(FixedDual<N> a, double b) { return a -= b; }
+template<int N> inline FixedDual<N> operator*(FixedDual<N> a, double b) { return a *= b; }
+template<int N> inline FixedDual<N> operator/(FixedDual<N> a, double b) { return a /= b; }
+
+template<int N> inline FixedDual<N> operator+(double a, FixedDual<N> b) { return b += a; }
+template<int N> inline FixedDual<N> operator-(double a, const FixedDual<N>& b) { FixedDual<N> r = -b; return r += a; }
+template<int N> inline FixedDual<N> operator*(double a, FixedDual<N> b) { return b *= a; }
+template<int N> inline FixedDual<N> operator/(double a, const FixedDual<N>& b) { return fd_chain(b, a/b.v, -a/(b.v*b.v)); }
+
+template<int N> inline bool operator< (const FixedDual<N>& a, const FixedDual<N>& b) { return a.v <  b.v; }
+template<int N> inline bool operator> (const FixedDual<N>& a, const FixedDual<N>& b) { return a.v >  b.v; }
+template<int N> inline bool operator<=(const FixedDual<N>& a, const FixedDual<N>& b) { return a.v <= b.v; }
+template<int N> inline bool operator>=(const FixedDual<N>& a, const FixedDual<N>& b) { return a.v >= b.v; }
+template<int N> inline bool operator< (const FixedDual<N>& a, double b) { return a.v <  b; }
+template<int N> inline bool operator> (const FixedDual<N>& a, double b) { return a.v >  b; }
+template<int N> inline bool operator<=(const FixedDual<N>& a, double b) { return a.v <= b; }
+template<int N> inline bool operator>=(const FixedDual<N>& a, double b) { return a.v >= b; }
+
+template<int N> inline FixedDual<N> sin (const FixedDual<N>& a) { return fd_chain(a, ::sin(a.v),  ::cos(a.v)); }
+template<int N> inline FixedDual<N> cos (const FixedDual<N>& a) { return fd_chain(a, ::cos(a.v), -::sin(a.v)); }
+template<int N> inline FixedDual<N> tan (const FixedDual<N>& a) { double t = ::tan(a.v); return fd_chain(a, t, 1.0+t*t); }
+template<int N> inline FixedDual<N> exp (const FixedDual<N>& a) { double e = ::exp(a.v); return fd_chain(a, e, e); }
+template<int N> inline FixedDual<N> log (const FixedDual<N>& a) { return fd_chain(a, ::log(a.v), 1.0/a.v); }
+template<int N> inline FixedDual<N> sqrt(const FixedDual<N>& a) { double s = ::sqrt(a.v); return fd_chain(a, s, 0.5/s); }
+template<int N> inline FixedDual<N> sinh(const FixedDual<N>& a) { return fd_chain(a, ::sinh(a.v), ::cosh(a.v)); }
+template<int N> inline FixedDual<N> cosh(const FixedDual<N>& a) { return fd_chain(a, ::cosh(a.v), ::sinh(a.v)); }
+template<int N> inline FixedDual<N> tanh(const FixedDual<N>& a) { double t = ::tanh(a.v); return fd_chain(a, t, 1.0-t*t); }
+template<int N> inline FixedDual<N> asin(const FixedDual<N>& a) { return fd_chain(a, ::asin(a.v),  1.0/::sqrt(1.0-a.v*a.v)); }
+template<int N> inline FixedDual<N> acos(const FixedDual<N>& a) { return fd_chain(a, ::acos(a.v), -1.0/::sqrt(1.0-a.v*a.v)); }
+template<int N> inline FixedDual<N> atan(const FixedDual<N>& a) { return fd_chain(a, ::atan(a.v),  1.0/(1.0+a.v*a.v)); }
+template<int N> inline FixedDual<N> fabs(const FixedDual<N>& a) { return fd_chain(a, ::fabs(a.v), (a.v < 0.0) ? -1.0 : 1.0); }
+template<int N> inline FixedDual<N> pow (const FixedDual<N>& a, double b) { return fd_chain(a, ::pow(a.v,b), b*::pow(a.v,b-1.0)); }
+template<int N> inline FixedDual<N> pow (const FixedDual<N>& a, const FixedDual<N>& b) { return exp( b*log(a) ); }
+template<int N> inline FixedDual<N> atan2(const FixedDual<N>& y, const FixedDual<N>& x)
+{
+   FixedDual<N> r;
+   double den = x.v*x.v + y.v*y.v;
+   r.v = ::atan2(y.v, x.v);
+   for (int i=0;i<N;i++) r.d[i] = (x.v*y.d[i] - y.v*x.d[i])/den;
+   return r;
+}
+
+
+
+template<int NS, int NC, int NN, int NE, class Model>
+class FixedSizeProblem : public FixedSizeEvaluator {
+public:
+
+   enum {
+      NV   = (NS+NC)*NN + 2,                // number of NLP variables
+      NG   = NS*NN + NE + 1,                // number of NLP constraints
+      NDEF = (NN-1) + NS + NC + 2,          // non-zeros in each defect row
+      NNZ  = NS*NN*NDEF + NE*(2*NS+2) + 2   // non-zeros in the constraint Jacobian
+   };
+
+   // Adaptors with the signatures of the PSOPT problem functions, used by the general path
+
+   static void dae(adouble* derivatives, adouble* path, adouble* states, adouble* controls, adouble* parameters,
+                   adouble& time, adouble* xad, int iphase, Workspace* workspace)
+   {
+      Model::dae(derivatives, (const adouble*) states, (const adouble*) controls, (const adouble&) time);
+   }
+
+   static adouble integrand_cost(adouble* states, adouble* controls, adouble* parameters, adouble& time,
+                                 adouble* xad, int iphase, Workspace* workspace)
+   {
+      return Model::integrand_cost( (const adouble*) states, (const adouble*) controls, (const adouble&) time );
+   }
+
+   static adouble endpoint_cost(adouble* initial_states, adouble* final_states, adouble* parameters, adouble& t0,
+                                adouble& tf, adouble* xad, int iphase, Workspace* workspace)
+   {
+      return Model::endpoint_cost( (const adouble*) initial_states, (const adouble*) final_states, (const adouble&) t0, (const adouble&) tf );
+   }
+
+   static void events(adouble* e, adouble* initial_states, adouble* final_states, adouble* parameters, adouble& t0,
+                      adouble& tf, adouble* xad, int iphase, Workspace* workspace)
+   {
+      Model::events( e, (const adouble*) initial_states, (const adouble*) final_states, (const adouble&) t0, (const adouble&) tf );
+   }
+
+   bool compatible(Workspace* workspace)
+   {
+      Prob& problem = *workspace->problem;
+      Alg&  algorithm = *workspace->algorithm;
+
+      if ( problem.nphases != 1 || problem.nlinkages != 0 || problem.multi_segment_flag || workspace->auto_linked_flag )
+           return false;
+
+      Phases& phase = problem.phase[0];
+
+      if ( phase.nstates != NS || phase.ncontrols != NC || phase.nevents != NE || phase.npath != 0 || phase.nparameters != 0 )
+           return false;
+
+      if ( phase.current_number_of_intervals+1 != NN || !use_global_collocation(algorithm) )
+           return false;
+
+      if ( workspace->differential_defects == "Hermite-Simpson" || workspace->differential_defects == "trapezoidal" )
+           return false;
+
+      return ( workspace->nvars == NV && workspace->ncons == NG );
+   }
+
+   int jacobian_nnz()
+   {
+      return NNZ;
+   }
+
+   void jacobian_structure(int* irow, int* jcol)
+   {
+      // Rows are listed in order. Defect rows contain the same state at all nodes, all the
+      // states and controls at their own node and the initial and final times.
+
+      int k, j, m, s, c, i;
+      int l = 0;
+
+      for (k=0; k<NN; k++) {
+          for (j=0; j<NS; j++) {
+              int row = k*NS + j;
+              for (m=0; m<NN; m++) {
+                  if (m != k) {
+                      irow[l] = row; jcol[l] = state_index(m,j); l++;
+                  }
+                  else {
+                      for (s=0; s<NS; s++) {
+                          irow[l] = row; jcol[l] = state_index(k,s); l++;
+                      }
+                  }
+              }
+              for (c=0; c<NC; c++) {
+                  irow[l] = row; jcol[l] = control_index(k,c); l++;
+              }
+              irow[l] = row; jcol[l] = NV-2; l++;
+              irow[l] = row; jcol[l] = NV-1; l++;
+          }
+      }
+
+      for (i=0; i<NE; i++) {
+          int row = NS*NN + i;
+          for (s=0; s<NS; s++) {
+              irow[l] = row; jcol[l] = state_index(0,s); l++;
+          }
+          for (s=0; s<NS; s++) {
+              irow[l] = row; jcol[l] = state_index(NN-1,s); l++;
+          }
+          irow[l] = row; jcol[l] = NV-2; l++;
+          irow[l] = row; jcol[l] = NV-1; l++;
+      }
+
+      irow[l] = NG-1; jcol[l] = NV-2; l++;
+      irow[l] = NG-1; jcol[l] = NV-1; l++;
+   }
+
+   double objective(const double* x, Workspace* workspace)
+   {
+      Factors sc;
+      double X[NN][NS], U[NN][NC+1];
+      double t0, tf;
+      int k;
+
+      load_scaling(sc, workspace);
+      unscale(x, sc, X, U, t0, tf);
+
+      double h   = (tf-t0)/2.0;
+      double sum = 0.0;
+
+      if (!sc.zero_integrand) {
+          for (k=0; k<NN; k++) {
+              double time = h*sc.snodes[k] + (tf+t0)/2.0;
+              double L = Model::integrand_cost( (const double*) X[k], (const double*) U[k], time );
+              sum += h*L*sc.w[k]*sc.cheb[k];
+          }
+      }
+
+      sum += Model::endpoint_cost( (const double*) X[0], (const double*) X[NN-1], t0, tf );
+
+      return ( sum*sc.obj );
+   }
+
+   void gradient(const double* x, double* grad, Workspace* workspace)
+   {
+      Factors sc;
+      double X[NN][NS], U[NN][NC+1];
+      double t0, tf;
+      double dt0 = 0.0, dtf = 0.0;
+      int k, s, c, i;
+
+      load_scaling(sc, workspace);
+      unscale(x, sc, X, U, t0, tf);
+
+      double h = (tf-t0)/2.0;
+
+      for (i=0; i<NV; i++) grad[i] = 0.0;
+
+      if (!sc.zero_integrand) {
+          for (k=0; k<NN; k++) {
+              // Derivatives of the integrand with respect to the states, controls and time at node k
+              FixedDual<NS+NC+1> xd[NS], ud[NC+1], td;
+              double ak = (1.0-sc.snodes[k])/2.0;
+              double bk = (1.0+sc.snodes[k])/2.0;
+              for (s=0; s<NS; s++) xd[s].seed( X[k][s], s );
+              for (c=0; c<NC; c++) ud[c].seed( U[k][c], NS+c );
+              td.seed( h*sc.snodes[k] + (tf+t0)/2.0, NS+NC );
+
+              FixedDual<NS+NC+1> L = Model::integrand_cost( (const FixedDual<NS+NC+1>*) xd, (const FixedDual<NS+NC+1>*) ud, td );
+
+              double f = sc.w[k]*sc.cheb[k];
+
+              for (s=0; s<NS; s++) grad[state_index(k,s)]   += h*f*L.d[s]/sc.ss[s];
+              for (c=0; c<NC; c++) grad[control_index(k,c)] += h*f*L.d[NS+c]/sc.cs[c];
+
+              dt0 += f*( -0.5*L.v + h*L.d[NS+NC]*ak );
+              dtf += f*(  0.5*L.v + h*L.d[NS+NC]*bk );
+          }
+      }
+
+      FixedDual<2*NS+2> x0d[NS], xfd[NS], t0d, tfd;
+      for (s=0; s<NS; s++) x0d[s].seed( X[0][s], s );
+      for (s=0; s<NS; s++) xfd[s].seed( X[NN-1][s], NS+s );
+      t0d.seed( t0, 2*NS );
+      tfd.seed( tf, 2*NS+1 );
+
+      FixedDual<2*NS+2> E = Model::endpoint_cost( (const FixedDual<2*NS+2>*) x0d, (const FixedDual<2*NS+2>*) xfd, t0d, tfd );
+
+      for (s=0; s<NS; s++) grad[state_index(0,s)]    += E.d[s]/sc.ss[s];
+      for (s=0; s<NS; s++) grad[state_index(NN-1,s)] += E.d[NS+s]/sc.ss[s];
+
+      dt0 += E.d[2*NS];
+      dtf += E.d[2*NS+1];
+
+      grad[NV-2] = dt0/sc.ts;
+      grad[NV-1] = dtf/sc.ts;
+
+      for (i=0; i<NV; i++) grad[i] *= sc.obj;
+   }
+
+   void constraints(const double* x, double* g, Workspace* workspace)
+   {
+      Factors sc;
+      double X[NN][NS], U[NN][NC+1];
+      double f[NS], e[NE+1];
+      double t0, tf;
+      int k, j, m, i;
+
+      load_scaling(sc, workspace);
+      unscale(x, sc, X, U, t0, tf);
+
+      double h = (tf-t0)/2.0;
+
+      for (k=0; k<NN; k++) {
+          double time = h*sc.snodes[k] + (tf+t0)/2.0;
+          Model::dae( f, (const double*) X[k], (const double*) U[k], time );
+          for (j=0; j<NS; j++) {
+              double deriv = 0.0;
+              for (m=0; m<NN; m++) deriv += sc.D[m*NN+k]*X[m][j];
+              g[k*NS+j] = (deriv - h*f[j])*sc.defect_scaling[j];
+          }
+      }
+
+      Model::events( e, (const double*) X[0], (const double*) X[NN-1], t0, tf );
+
+      for (i=0; i<NE; i++) g[NS*NN+i] = e[i]*sc.event_scaling[i];
+
+      g[NG-1] = (t0-tf)*sc.ts;
+
+      if (sc.cons != NULL) {
+          for (i=0; i<NG; i++) g[i] *= sc.cons[i];
+      }
+   }
+
+   void jacobian(const double* x, double* values, Workspace* workspace)
+   {
+      // Values in the order given by jacobian_structure()
+
+      Factors sc;
+      double X[NN][NS], U[NN][NC+1];
+      double t0, tf;
+      int k, j, m, s, c, i;
+      int l = 0;
+
+      load_scaling(sc, workspace);
+      unscale(x, sc, X, U, t0, tf);
+
+      double h = (tf-t0)/2.0;
+
+      for (k=0; k<NN; k++) {
+          FixedDual<NS+NC+1> xd[NS], ud[NC+1], td, fd[NS];
+          double ak = (1.0-sc.snodes[k])/2.0;
+          double bk = (1.0+sc.snodes[k])/2.0;
+          for (s=0; s<NS; s++) xd[s].seed( X[k][s], s );
+          for (c=0; c<NC; c++) ud[c].seed( U[k][c], NS+c );
+          td.seed( h*sc.snodes[k] + (tf+t0)/2.0, NS+NC );
+
+          Model::dae( fd, (const FixedDual<NS+NC+1>*) xd, (const FixedDual<NS+NC+1>*) ud, td );
+
+          for (j=0; j<NS; j++) {
+              double rs = sc.defect_scaling[j]*( sc.cons ? sc.cons[k*NS+j] : 1.0 );
+              for (m=0; m<NN; m++) {
+                  if (m != k) {
+                      values[l++] = sc.D[m*NN+k]/sc.ss[j]*rs;
+                  }
+                  else {
+                      for (s=0; s<NS; s++) {
+                          values[l++] = ( (s==j ? sc.D[k*NN+k] : 0.0) - h*fd[j].d[s] )/sc.ss[s]*rs;
+                      }
+                  }
+              }
+              for (c=0; c<NC; c++) {
+                  values[l++] = -h*fd[j].d[NS+c]/sc.cs[c]*rs;
+              }
+              values[l++] = (  0.5*fd[j].v - h*fd[j].d[NS+NC]*ak )/sc.ts*rs;
+              values[l++] = ( -0.5*fd[j].v - h*fd[j].d[NS+NC]*bk )/sc.ts*rs;
+          }
+      }
+
+      FixedDual<2*NS+2> x0d[NS], xfd[NS], t0d, tfd, ed[NE+1];
+      for (s=0; s<NS; s++) x0d[s].seed( X[0][s], s );
+      for (s=0; s<NS; s++) xfd[s].seed( X[NN-1][s], NS+s );
+      t0d.seed( t0, 2*NS );
+      tfd.seed( tf, 2*NS+1 );
+
+      Model::events( ed, (const FixedDual<2*NS+2>*) x0d, (const FixedDual<2*NS+2>*) xfd, t0d, tfd );
+
+      for (i=0; i<NE; i++) {
+          double rs = sc.event_scaling[i]*( sc.cons ? sc.cons[NS*NN+i] : 1.0 );
+          for (s=0; s<NS; s++) values[l++] = ed[i].d[s]/sc.ss[s]*rs;
+          for (s=0; s<NS; s++) values[l++] = ed[i].d[NS+s]/sc.ss[s]*rs;
+          values[l++] = ed[i].d[2*NS]/sc.ts*rs;
+          values[l++] = ed[i].d[2*NS+1]/sc.ts*rs;
+      }
+
+      double rs = ( sc.cons ? sc.cons[NG-1] : 1.0 );
+      values[l++] =  rs;
+      values[l++] = -rs;
+   }
+
+private:
+
+   // Scaling factors and collocation data read from the workspace at each call
+
+   struct Factors {
+      double  ss[NS];
+      double  cs[NC+1];
+      double  defect_scaling[NS];
+      double  event_scaling[NE+1];
+      double  cheb[NN];
+      double  ts;
+      double  obj;
+      bool    zero_integrand;
+      const double* D;
+      const double* snodes;
+      const double* w;
+      const double* cons;
+   };
+
+   static int control_index(int k, int c) { return k*NC + c; }
+
+   static int state_index(int k, int s)   { return NC*NN + k*NS + s; }
+
+   static void load_scaling(Factors& sc, Workspace* workspace)
+   {
+      Prob& problem   = *workspace->problem;
+      Alg&  algorithm = *workspace->algorithm;
+      Phases& phase   = problem.phase[0];
+      bool user_scaling = ( algorithm.scaling == "user" );
+      int i;
+
+      for (i=0; i<NS; i++) sc.ss[i] = phase.scale.states.GetPr()[i];
+      for (i=0; i<NC; i++) sc.cs[i] = phase.scale.controls.GetPr()[i];
+      for (i=0; i<NS; i++) sc.defect_scaling[i] = user_scaling ? phase.scale.defects.GetPr()[i] : 1.0;
+      for (i=0; i<NE; i++) sc.event_scaling[i]  = user_scaling ? phase.scale.events.GetPr()[i]  : 1.0;
+
+      sc.ts  = phase.scale.time;
+      sc.obj = ( problem.scale.objective != -1 ) ? problem.scale.objective : 1.0;
+      sc.zero_integrand = phase.zero_cost_integrand;
+
+      sc.D      = workspace->D[0].GetPr();
+      sc.snodes = workspace->snodes[0].GetPr();
+      sc.w      = workspace->w[0].GetPr();
+      sc.cons   = ( !user_scaling && workspace->use_constraint_scaling ) ? workspace->constraint_scaling->GetPr() : NULL;
+
+      for (i=0; i<NN; i++) {
+         // Reciprocal of the Chebyshev weighting function, see ff_ad()
+         sc.cheb[i] = ( algorithm.collocation_method == "Chebyshev" ) ? ::sqrt( 1.0 - sc.snodes[i]*sc.snodes[i] ) : 1.0;
+      }
+   }
+
+   static void unscale(const double* x, const Factors& sc, double X[NN][NS], double U[NN][NC+1], double& t0, double& tf)
+   {
+      int k, s, c;
+
+      for (k=0; k<NN; k++) {
+          for (c=0; c<NC; c++) U[k][c] = x[control_index(k,c)]/sc.cs[c];
+          for (s=0; s<NS; s++) X[k][s] = x[state_index(k,s)]/sc.ss[s];
+      }
+
+      t0 = x[NV-2]/sc.ts;
+      tf = x[NV-1]/sc.ts;
+   }
+
+};
+
+
+#endif // __FIXED_SIZE_H__
@@ -30,6 +30,7 @@ e-mail:    v.m.becerra@ieee.org
 
 
 #include "psopt.h"
+#include <algorithm>
 
 
 
@@ -42,31 +43,124 @@ void lagrange_interpolation(DMatrix& y, DMatrix& x, DMatrix& pointx, DMatrix& po
 //       P1=(POINTX(1),POINTY(1)), P2=(POINTX(2),POINTY(2)), ..., PN(POINTX(N),POINTY(N))
 //       and calculate it in each element of X
 
+   long n = length(pointx);
+
+   DMatrix w(1,n);
+
+   barycentric_weights(pointx.GetPr(), w.GetPr(), (int) n);
+
+   lagrange_interpolation(y, x, pointx, pointy, w);
+}
+
+
+void lagrange_interpolation(DMatrix& y, DMatrix& x, DMatrix& pointx, DMatrix& pointy, DMatrix& w)
+{
+//
+//       As above, given the barycentric weights w of the interpolation points, which can be
+//       computed once with barycentric_weights() or pseudospectral_barycentric_weights() and
+//       reused for all the functions tabulated at the same points.
+
+   y.Resize(1,length(x));
+
+   barycentric_interpolation(y.GetPr(), x.GetPr(), (int) length(x), pointx.GetPr(), pointy.GetPr(), w.GetPr(), (int) length(pointx));
+}
+
+
+void barycentric_interpolation(double* y, const double* x, int m, const double* pointx, const double* pointy, const double* w, int n)
+{
+//
+//       This function evaluates at the points x[0],...,x[m-1] the polynomial which interpolates
+//       (pointx[j],pointy[j]), j=0,...,n-1, using the second (true) form of the barycentric
+//       formula, given the barycentric weights w[]. Each point costs O(n) operations and the
+//       results are written into the caller supplied array y[].
 
    int i,j;
 
-   long n = length(pointx);
+   for (i=0;i<m;i++) {
+
+       double num = 0.0;
+       double den = 0.0;
+       int    hit = -1;
+
+       for (j=0;j<n;j++) {
+            double d = x[i]-pointx[j];
+            if (d == 0.0) {
+                 hit = j;
+                 break;
+            }
+            double a = w[j]/d;
+            num += a*pointy[j];
+            den += a;
+       }
 
-   DMatrix L(n, x.GetNoCols() );
+       y[i] = (hit>=0) ? pointy[hit] : num/den;
+   }
 
-   for(i=1;i<=n;i++) {
-	for(j=1;j<=x.GetNoCols();j++) {
-            L(i,j) = 1.0;
-	}
-    }
+}
 
-   for (i=1;i<=n;i++) {
-      for (j=1;j<=n;j++) {
-           if (i != j) {
-                L(i,colon()) = ( L(i,colon())&(  x-pointx(j)*ones(1,length(x)) )  )/(pointx(i)-pointx(j));
-           }
-      }
+
+void lgl_barycentric_weights(const double* x, double* w, int n)
+{
+//
+//       Closed form barycentric weights for the n Legendre-Gauss-Lobatto points (or an affine map of
+//       them) sorted in ascending order: w[j] is proportional to 1/P_N(s[j]), where P_N is the Legendre
+//       polynomial of degree N=n-1 and s[j] the point mapped to [-1,1].
+
+   int j, k;
+   int N = n-1;
+   double wmax = 0.0;
+
+   for (j=0;j<n;j++) {
+       double s = (n>1) ? (2.0*x[j]-(x[0]+x[N]))/(x[N]-x[0]) : 0.0;
+       double p0 = 1.0, p1 = s, p2;
+       for (k=2;k<=N;k++) {
+           p2 = ( (2.0*k-1.0)*s*p1 - (k-1.0)*p0 )/k;
+           p0 = p1;
+           p1 = p2;
+       }
+       w[j] = 1.0/( (N==0) ? p0 : p1 );
+       wmax = MAX(wmax, fabs(w[j]));
    }
 
-   y.Resize(1,length(x));
-   y.FillWithZeros();
-   for (i=1;i<=n;i++) {
-   	y = y+pointy(i)*L(i,colon());
+   for (j=0;j<n;j++) w[j] /= wmax;
+}
+
+
+void cgl_barycentric_weights(double* w, int n)
+{
+//
+//       Closed form barycentric weights for the n Chebyshev-Gauss-Lobatto points:
+//       w[j] = (-1)^j d[j], with d[j]=1/2 at both ends and 1 otherwise.
+
+   int j;
+
+   for (j=0;j<n;j++) {
+       w[j] = (j%2==0) ? 1.0 : -1.0;
+   }
+
+   w[0]   *= 0.5;
+   w[n-1] *= 0.5;
+}
+
+
+void pseudospectral_barycentric_weights(DMatrix& nodes, DMatrix& w, Alg& algorithm)
+{
+//
+//       Barycentric weights for the nodes of a pseudospectral mesh (or the corresponding times),
+//       using the closed form expressions for LGL and CGL nodes.
+
+   int n = (int) length(nodes);
+
+   w.Resize(1,n);
+
+   if (algorithm.collocation_method == "Legendre") {
+       lgl_barycentric_weights(nodes.GetPr(), w.GetPr(), n);
+   }
+   else if (algorithm.collocation_method == "Chebyshev") {
+       cgl_barycentric_weights(w.GetPr(), n);
+   }
+   else {
+       barycentric_weights(nodes.GetPr(), w.GetPr(), n);
    }
 }
 
@@ -106,6 +200,44 @@ void lagrange_interpolation_ad(adouble* y, adouble& x, adouble* pointx, adouble*
 }
 
 
+void barycentric_weights(const double* x, double* w, int n)
+{
+//
+//       This function computes the weights of the barycentric form of the Lagrange
+//       polynomial which interpolates at the distinct points x[0],...,x[n-1].
+//       The products are scaled by the inverse of the capacity 4/(max(x)-min(x)) to
+//       avoid overflow, and the weights are normalised, as only their ratios matter.
+//
+//       Reference: J.P. Berrut and L.N. Trefethen (2004) "Barycentric Lagrange
+//       interpolation", SIAM Review 46(3), pp. 501-517.
+
+   int i,j;
+
+   double xmin = x[0], xmax = x[0];
+
+   for (i=1;i<n;i++) {
+       xmin = MIN(xmin, x[i]);
+       xmax = MAX(xmax, x[i]);
+   }
+
+   double C = (n>1 && xmax>xmin) ? 4.0/(xmax-xmin) : 1.0;
+
+   double wmax = 0.0;
+
+   for (i=0;i<n;i++) {
+       w[i] = 1.0;
+       for (j=0;j<n;j++) {
+            if (i != j) w[i] *= C*(x[i]-x[j]);
+       }
+       w[i] = 1.0/w[i];
+       wmax = MAX(wmax, fabs(w[i]));
+   }
+
+   for (i=0;i<n;i++) w[i] /= wmax;
+
+}
+
+
 void linear_interpolation(adouble* y, adouble& x, adouble* pointx, adouble* pointy, int npoints)
 {
 //    Linear interpolation from point values (version for automatic differentiation)
@@ -579,7 +711,7 @@ void bilinear_interpolation(adouble* z, adouble& x, adouble& y, DMatrix& X, DMat
 
 
 
-  if ( x.value() > Y(nypoints) )
+  if ( y.value() > Y(nypoints) )
    {
       jy=nypoints-1;
       jydone = true;
@@ -775,44 +907,15 @@ void spline_interpolation(adouble* y, adouble& x, DMatrix& Xdata, DMatrix& Ydata
 
 void spline_interpolation(DMatrix& Y, DMatrix& X, DMatrix& Xdata, DMatrix& Ydata, int n)
 //   Given the arrays xdata[i] and ydata[i], i = 0,...n-1, which tabulate a function, with xdata[i] < xdata[i+1],
-//   and given the array d2y[i], which is the output from function spline_second_derivative(),
 //   and given a vector of independent varaibles X, this function returns a vector of interpolated values Y
-//   using (natural) cubic-spline interpolation
+//   using (natural) cubic-spline interpolation. The spline coefficients are computed once for all the
+//   entries of X.
 //
 //   Reference: Burden and Faires (2005) "Numerical Analysis". Thompson.
 {
+   CubicSpline spline( Xdata.GetPr(), Ydata.GetPr(), n );
 
-
-   double *xdata = Xdata.GetPr();
-   double *ydata = Ydata.GetPr();
-   int kleft,kright,k;
-   double h,A,B,C,D;
-   DMatrix D2Y(1,n);
-   double* d2y = D2Y.GetPr();
-   int i;
-
-   spline_second_derivative(Xdata, Ydata, n, D2Y );
-
-
-   for(i=1;i<= length(X); i++) {
-      kleft=1;
-      kright=n;
-      while (kright-kleft > 1) {
-	  k=(int) ( (kright+kleft)/2 );
-	  if (xdata[k-1] > X(i)) kright=k;
-	  else kleft=k;
-      }
-      h=xdata[kright-1]-xdata[kleft-1];
-      if (h == 0.0) error_message("Bad xdata input to routine spline_interpolation()");
-      A=(xdata[kright-1]-X(i))/h;
-      B=(X(i)-xdata[kleft-1])/h;
-      C=(pow(A,3)-A)*(h*h)/6.0;
-      D=(pow(B,3)-B)*(h*h)/6.0;
-      // Evaluate the cubic spline polynomial
-      Y(i)=A*ydata[kleft-1]+B*ydata[kright-1]+C*d2y[kleft-1]+D*d2y[kright-1];
-
-
-   } // End for loop
+   spline.Evaluate( X, Y );
 }
 
 
@@ -851,6 +954,423 @@ void spline_interpolation_with_second_derivative(adouble* y, adouble& x, adouble
 }
 
 
+static void natural_spline_coefficients(const double* x, const double* y, int n, double* b, double* c, double* d)
+// Computes the coefficients of the natural cubic spline through the points
+// (x[i], y[i]), i=0,...,n-1, so that in the interval [x[k], x[k+1]]:
+//   s(x) = y[k] + b[k]*t + c[k]*t^2 + d[k]*t^3,   with t = x - x[k]
+// The entries b[n-1], c[n-1] and d[n-1] are set to zero.
+//
+// Reference: Burden and Faires (2005) "Numerical Analysis". Thompson.
+{
+   int k;
+   double h;
+
+   DMatrix X(1,n), Y(1,n), D2Y(1,n);
+
+   for(k=0;k<n;k++) {
+      X.GetPr()[k] = x[k];
+      Y.GetPr()[k] = y[k];
+   }
+
+   spline_second_derivative(X, Y, n, D2Y);
+
+   double* d2y = D2Y.GetPr();
+
+   for(k=0;k<n-1;k++) {
+      h    = x[k+1]-x[k];
+      b[k] = (y[k+1]-y[k])/h - h*(2.0*d2y[k]+d2y[k+1])/6.0;
+      c[k] = 0.5*d2y[k];
+      d[k] = (d2y[k+1]-d2y[k])/(6.0*h);
+   }
+
+   b[n-1] = 0.0;
+   c[n-1] = 0.0;
+   d[n-1] = 0.0;
+}
+
+static int locate_interval(const double* x, int n, double v, int* hint)
+// Returns the index k of the interval [x[k], x[k+1]] that contains v.
+// Points outside the table are assigned to the first or last interval.
+// The interval given by *hint is tried first, followed by its successor,
+// so monotonic sequences of queries are located in O(1) time, otherwise
+// a bisection search is done. On exit *hint is set to the interval found.
+{
+   int k = *hint;
+
+   if ( v >= x[k] && v <= x[k+1] ) return k;
+
+   if ( k+2 < n && v > x[k+1] && v <= x[k+2] ) {
+        *hint = k+1;
+        return *hint;
+   }
+
+   int kleft  = 0;
+   int kright = n-1;
+   while (kright-kleft > 1) {
+      k = (kright+kleft)/2;
+      if (x[k] > v) kright=k;
+      else kleft=k;
+   }
+   *hint = kleft;
+   return *hint;
+}
+
+static void check_strictly_increasing(const double* x, int n, const char* caller)
+{
+   int k;
+   for(k=0;k<n-1;k++) {
+      if ( x[k+1] <= x[k] ) {
+           error_message( (string("Bad input data in ")+caller+", the abscissas should be strictly increasing").c_str() );
+      }
+   }
+}
+
+CubicSpline::CubicSpline()
+{
+   n  = 0;
+   hint = 0;
+   xd = NULL;
+   a  = NULL;
+   b  = NULL;
+   c  = NULL;
+   d  = NULL;
+}
+
+CubicSpline::CubicSpline(DMatrix& xdata, DMatrix& ydata)
+{
+   n  = 0;
+   xd = NULL;
+   a  = NULL;
+   b  = NULL;
+   c  = NULL;
+   d  = NULL;
+   if ( length(xdata) != length(ydata) ) {
+        error_message("Inconsistent dimensions of xdata and ydata in CubicSpline constructor");
+   }
+   Set( xdata.GetPr(), ydata.GetPr(), (int) length(xdata) );
+}
+
+CubicSpline::CubicSpline(const double* xdata, const double* ydata, int npoints)
+{
+   n  = 0;
+   xd = NULL;
+   a  = NULL;
+   b  = NULL;
+   c  = NULL;
+   d  = NULL;
+   Set( xdata, ydata, npoints );
+}
+
+CubicSpline::~CubicSpline()
+{
+   delete [] xd;
+   delete [] a;
+   delete [] b;
+   delete [] c;
+   delete [] d;
+}
+
+void CubicSpline::Set(const double* xdata, const double* ydata, int npoints)
+// Computes the coefficients of the natural cubic spline through the points
+// (xdata[i], ydata[i]), i=0,...,npoints-1.
+{
+   int k;
+
+   if (npoints < 2) error_message("At least two points are required in CubicSpline::Set()");
+
+   check_strictly_increasing(xdata, npoints, "CubicSpline::Set()");
+
+   if (npoints != n) {
+      delete [] xd;
+      delete [] a;
+      delete [] b;
+      delete [] c;
+      delete [] d;
+      n  = npoints;
+      xd = new double[n];
+      a  = new double[n];
+      b  = new double[n];
+      c  = new double[n];
+      d  = new double[n];
+   }
+
+   hint = 0;
+
+   for(k=0;k<n;k++) {
+      xd[k] = xdata[k];
+      a[k]  = ydata[k];
+   }
+
+   natural_spline_coefficients(xd, a, n, b, c, d);
+}
+
+int CubicSpline::FindInterval(double x)
+{
+   return locate_interval(xd, n, x, &hint);
+}
+
+double CubicSpline::Evaluate(double x)
+{
+   int k = FindInterval(x);
+   double t = x - xd[k];
+   return a[k] + t*(b[k] + t*(c[k] + t*d[k]));
+}
+
+double CubicSpline::Derivative(double x)
+{
+   int k = FindInterval(x);
+   double t = x - xd[k];
+   return b[k] + t*(2.0*c[k] + 3.0*t*d[k]);
+}
+
+adouble CubicSpline::Evaluate(const adouble& x)
+// The interval is selected using the value of x, so only the operations
+// needed to evaluate one cubic polynomial are recorded in the tape.
+{
+   int k = FindInterval(x.value());
+   adouble t = x - xd[k];
+   return a[k] + t*(b[k] + t*(c[k] + t*d[k]));
+}
+
+adouble CubicSpline::Derivative(const adouble& x)
+{
+   int k = FindInterval(x.value());
+   adouble t = x - xd[k];
+   return b[k] + t*(2.0*c[k] + 3.0*t*d[k]);
+}
+
+void CubicSpline::Evaluate(const double* x, double* y, int m)
+{
+   int i;
+   for(i=0;i<m;i++) {
+      y[i] = Evaluate(x[i]);
+   }
+}
+
+void CubicSpline::Derivative(const double* x, double* dy, int m)
+{
+   int i;
+   for(i=0;i<m;i++) {
+      dy[i] = Derivative(x[i]);
+   }
+}
+
+void CubicSpline::Evaluate(DMatrix& X, DMatrix& Y)
+{
+   if ( length(Y) != length(X) ) Y.Resize(X.GetNoRows(), X.GetNoCols());
+   Evaluate(X.GetPr(), Y.GetPr(), (int) length(X));
+}
+
+
+LookupTable2D::LookupTable2D(DMatrix& X, DMatrix& Y, DMatrix& Z, const string& method)
+//    Inputs:
+//    X is a vector of dimension nxpoints x 1
+//    Y is a vector of dimension nypoints x 1
+//    Z is a matrix of dimensions nxpoints x nypoints
+//    Each element Z(i,j) corresponds to the pair ( X(i), Y(j) )
+//    method is either "spline" or "bilinear".
+//    The coefficients of cell (k,j) are stored contiguously as a 4 x 4 block,
+//    so that for X(k) <= x <= X(k+1) and Y(j) <= y <= Y(j+1):
+//    z = sum_{p,q} coef[p][q] * (x-X(k))^p * (y-Y(j))^q
+{
+   int i, j, k, p, q;
+
+   nx = (int) length(X);
+   ny = (int) length(Y);
+
+   if ( Z.GetNoRows() != nx ) {
+       error_message("Number of rows of matrix Z must be equal to the length of vector X in LookupTable2D constructor");
+   }
+   if ( Z.GetNoCols() != ny )  {
+       error_message("Number of columns of matrix Z must be equal to the length of vector Y in LookupTable2D constructor");
+   }
+   if ( nx < 2 || ny < 2 ) {
+       error_message("At least two points are required along each axis in LookupTable2D constructor");
+   }
+
+   if      ( method == "spline"   ) order = 4;
+   else if ( method == "bilinear" ) order = 2;
+   else error_message("Unknown interpolation method in LookupTable2D constructor");
+
+   xd    = new double[nx];
+   yd    = new double[ny];
+   coef  = new double[(nx-1)*(ny-1)*16];
+   hintx = 0;
+   hinty = 0;
+
+   for(i=0;i<nx;i++) xd[i] = X.GetPr()[i];
+   for(j=0;j<ny;j++) yd[j] = Y.GetPr()[j];
+
+   check_strictly_increasing(xd, nx, "LookupTable2D constructor");
+   check_strictly_increasing(yd, ny, "LookupTable2D constructor");
+
+   for(i=0; i<(nx-1)*(ny-1)*16; i++) coef[i] = 0.0;
+
+   if (order == 2) {
+      double hx, hy, z11, z12, z21, z22, *K;
+      for(k=0;k<nx-1;k++) {
+         for(j=0;j<ny-1;j++) {
+            K   = coef + (k*(ny-1)+j)*16;
+            hx  = xd[k+1]-xd[k];
+            hy  = yd[j+1]-yd[j];
+            z11 = Z(k+1,j+1);   z12 = Z(k+1,j+2);
+            z21 = Z(k+2,j+1);   z22 = Z(k+2,j+2);
+            K[0] = z11;
+            K[1] = (z12-z11)/hy;
+            K[4] = (z21-z11)/hx;
+            K[5] = (z22-z21-z12+z11)/(hx*hy);
+         }
+      }
+      return;
+   }
+
+   // The 2D spline is a natural spline along Y through each row of Z, followed
+   // by a natural spline along X through the values obtained from each row.
+   // Both operations are linear, so the x-spline is expressed in terms of the
+   // cardinal splines w_i(x), which interpolate the unit vectors e_i, and the
+   // cell coefficients follow from the product of the row-spline coefficients
+   // and the cardinal-spline coefficients.
+
+   DMatrix Crow(4, nx*ny);   // Coefficients of the row splines in y
+   DMatrix Wcard(4, nx*nx);  // Coefficients of the cardinal splines in x
+   DMatrix row(1,ny), e(1,nx);
+   double *cr = Crow.GetPr();
+   double *wc = Wcard.GetPr();
+   double *a, *b, *c, *d;
+   DMatrix B(1,MAX(nx,ny)), C(1,MAX(nx,ny)), D(1,MAX(nx,ny));
+   b = B.GetPr(); c = C.GetPr(); d = D.GetPr();
+
+   for(i=0;i<nx;i++) {
+      for(j=0;j<ny;j++) row.GetPr()[j] = Z(i+1,j+1);
+      a = row.GetPr();
+      natural_spline_coefficients(yd, a, ny, b, c, d);
+      for(j=0;j<ny;j++) {
+         cr[(i*ny+j)*4+0] = a[j];
+         cr[(i*ny+j)*4+1] = b[j];
+         cr[(i*ny+j)*4+2] = c[j];
+         cr[(i*ny+j)*4+3] = d[j];
+      }
+   }
+
+   for(i=0;i<nx;i++) {
+      for(k=0;k<nx;k++) e.GetPr()[k] = (k==i)? 1.0 : 0.0;
+      a = e.GetPr();
+      natural_spline_coefficients(xd, a, nx, b, c, d);
+      for(k=0;k<nx;k++) {
+         wc[(i*nx+k)*4+0] = a[k];
+         wc[(i*nx+k)*4+1] = b[k];
+         wc[(i*nx+k)*4+2] = c[k];
+         wc[(i*nx+k)*4+3] = d[k];
+      }
+   }
+
+   for(k=0;k<nx-1;k++) {
+      for(j=0;j<ny-1;j++) {
+         double* K = coef + (k*(ny-1)+j)*16;
+         for(i=0;i<nx;i++) {
+            const double* w  = wc + (i*nx+k)*4;
+            const double* cy = cr + (i*ny+j)*4;
+            for(p=0;p<4;p++) {
+               if (w[p] == 0.0) continue;
+               for(q=0;q<4;q++) K[4*p+q] += w[p]*cy[q];
+            }
+         }
+      }
+   }
+}
+
+LookupTable2D::~LookupTable2D()
+{
+   delete [] xd;
+   delete [] yd;
+   delete [] coef;
+}
+
+double LookupTable2D::Evaluate(double x, double y)
+{
+   int k = locate_interval(xd, nx, x, &hintx);
+   int j = locate_interval(yd, ny, y, &hinty);
+   const double* K = coef + (k*(ny-1)+j)*16;
+   double u = x - xd[k];
+   double t = y - yd[j];
+   double z = 0.0;
+   int p;
+
+   if (order == 2) {
+      return (K[0] + K[1]*t) + u*(K[4] + K[5]*t);
+   }
+
+   for(p=3;p>=0;p--) {
+      z = z*u + (K[4*p] + t*(K[4*p+1] + t*(K[4*p+2] + t*K[4*p+3])));
+   }
+   return z;
+}
+
+adouble LookupTable2D::Evaluate(const adouble& x, const adouble& y)
+// The cell is selected using the values of x and y, so only the operations
+// needed to evaluate one polynomial are recorded in the tape.
+{
+   int k = locate_interval(xd, nx, x.value(), &hintx);
+   int j = locate_interval(yd, ny, y.value(), &hinty);
+   const double* K = coef + (k*(ny-1)+j)*16;
+   adouble u = x - xd[k];
+   adouble t = y - yd[j];
+   adouble z;
+   int p;
+
+   if (order == 2) {
+      return (K[0] + K[1]*t) + u*(K[4] + K[5]*t);
+   }
+
+   z = K[12] + t*(K[13] + t*(K[14] + t*K[15]));
+   for(p=2;p>=0;p--) {
+      z = z*u + (K[4*p] + t*(K[4*p+1] + t*(K[4*p+2] + t*K[4*p+3])));
+   }
+   return z;
+}
+
+void LookupTable2D::Evaluate(const double* x, const double* y, double* z, int m)
+// Evaluates the table at the m points (x[i],y[i]). The cells are located
+// first, so that the evaluation loop works on contiguous arrays without
+// branches.
+{
+   int i, p;
+   int* cell = new int[m];
+   double* u = new double[m];
+   double* t = new double[m];
+
+   for(i=0;i<m;i++) {
+      int k = locate_interval(xd, nx, x[i], &hintx);
+      int j = locate_interval(yd, ny, y[i], &hinty);
+      cell[i] = (k*(ny-1)+j)*16;
+      u[i] = x[i] - xd[k];
+      t[i] = y[i] - yd[j];
+   }
+
+   for(i=0;i<m;i++) {
+      const double* K = coef + cell[i];
+      double zi = 0.0;
+      for(p=3;p>=0;p--) {
+         zi = zi*u[i] + (K[4*p] + t[i]*(K[4*p+1] + t[i]*(K[4*p+2] + t[i]*K[4*p+3])));
+      }
+      z[i] = zi;
+   }
+
+   delete [] cell;
+   delete [] u;
+   delete [] t;
+}
+
+void LookupTable2D::Evaluate(DMatrix& X, DMatrix& Y, DMatrix& Z)
+{
+   if ( length(X) != length(Y) ) {
+       error_message("Inconsistent dimensions of X and Y in LookupTable2D::Evaluate()");
+   }
+   if ( length(Z) != length(X) ) Z.Resize(X.GetNoRows(), X.GetNoCols());
+   Evaluate(X.GetPr(), Y.GetPr(), Z.GetPr(), (int) length(X));
+}
+
+
 void resample_trajectory(DMatrix& Y,  DMatrix& X, DMatrix& Ydata, DMatrix& Xdata )
 {
 //  This function resamples a trajectory (Xdata,Ydata) given new values of the time vector Xdata using
@@ -859,30 +1379,92 @@ void resample_trajectory(DMatrix& Y,  DMatrix& X, DMatrix& Ydata, DMatrix& Xdata
 //   Ydata has dimensions ny x N
 //   X has dimension 1 x M
 //   On output, Y has dimensions ny x M
-//   Xdata and X should be monotonically increasing vectors.
-    int i;
+//   Xdata should be a monotonically increasing vector.
+//   The spline coefficients of all rows are computed once and stored by interval, the output
+//   times are visited in increasing order, so the bracketing interval only moves forward, and
+//   all rows are evaluated for each output time.
+    int i, k, m, p;
+
+    int ny = (int) Ydata.GetNoRows();
+
+    int lx = (int) length(X);
+
+    int n = (int) length(Xdata);
+
+    if ( Ydata.GetNoCols() != n ) {
+         error_message("Number of columns of Ydata must be equal to the length of Xdata in function resample_trajectory()");
+    }
+
+    if (n < 2) error_message("At least two points are required in function resample_trajectory()");
+
+    Y.Resize(ny,lx);
+
+    if (lx == 0 || ny == 0) return;
 
-    int ny = Ydata.GetNoRows();
+    double* xd = Xdata.GetPr();
+    double* x  = X.GetPr();
+    double* y  = Y.GetPr();
+    double* yd = Ydata.GetPr();
 
-    int lx = length(X);
+    check_strictly_increasing(xd, n, "resample_trajectory()");
 
-    int n = length(Xdata);
+    // Visiting order of the output times
 
-    DMatrix Yi, Yidata;
+    int* order = new int[lx];
 
-    if ( (X(1) < Xdata(1)) || X("end") > Xdata("end") ) {
+    bool sorted = true;
+
+    for(m=0;m<lx;m++) {
+        order[m] = m;
+        if ( m>0 && x[m] < x[m-1] ) sorted = false;
+    }
+
+    if (!sorted) {
+        std::sort( order, order+lx, [x](int m1, int m2) { return x[m1] < x[m2]; } );
+    }
+
+    if ( x[order[0]] < xd[0] || x[order[lx-1]] > xd[n-1] ) {
+         delete [] order;
          error_message("No extrapolation is allowed in function resample_trajectory()");
     }
 
-    Y.Resize(ny,lx);
-    Yi.Resize(1,lx);
-    Yidata.Resize(1,n);
+    // Spline coefficients, coef[(k*ny+i)*4+p] is the coefficient of t^p for row i in interval k
+
+    double* coef = new double[n*ny*4];
 
-    for(i=1;i<=ny;i++) {
-        Yidata = Ydata(i,colon());
-      	spline_interpolation( Yi, X, Xdata, Yidata, n);
-        Y(i,colon()) = Yi;
+    DMatrix row(1,n), B(1,n), C(1,n), D(1,n);
+
+    double* a = row.GetPr();
+    double* b = B.GetPr();
+    double* c = C.GetPr();
+    double* d = D.GetPr();
+
+    for(i=0;i<ny;i++) {
+        for(k=0;k<n;k++) a[k] = yd[k*ny+i];
+        natural_spline_coefficients(xd, a, n, b, c, d);
+        for(k=0;k<n;k++) {
+            coef[(k*ny+i)*4+0] = a[k];
+            coef[(k*ny+i)*4+1] = b[k];
+            coef[(k*ny+i)*4+2] = c[k];
+            coef[(k*ny+i)*4+3] = d[k];
+        }
     }
-}
 
+    // Single sweep over the output times
+
+    k = 0;
 
+    for(p=0;p<lx;p++) {
+        m = order[p];
+        while ( k < n-2 && x[m] > xd[k+1] ) k++;
+        double t = x[m] - xd[k];
+        const double* K = coef + k*ny*4;
+        double* ym = y + m*ny;
+        for(i=0;i<ny;i++) {
+            ym[i] = K[4*i] + t*(K[4*i+1] + t*(K[4*i+2] + t*K[4*i+3]));
+        }
+    }
+
+    delete [] coef;
+    delete [] order;
+}
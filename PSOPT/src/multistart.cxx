@@ -0,0 +1,383 @@
+/*********************************************************************************************
+
+This file is part of the PSOPT library, a software tool for computational optimal control
+
+Copyright (C) 2009-2020 Victor M. Becerra
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA,
+or visit http://www.gnu.org/licenses/
+
+Author:    Professor Victor M. Becerra
+Address:   University of Portsmouth
+           School of Energy and Electronic Engineering
+           Portsmouth PO1 3DJ
+           United Kingdom
+e-mail:    v.m.becerra@ieee.org
+
+**********************************************************************************************/
+
+
+
+#include "psopt.h"
+#include <mutex>
+#include <thread>
+
+
+// State shared by the threads of a multi-start solve
+
+struct multistart_run_str {
+   MultiStart*       multistart;
+   Prob*             problem;
+   Alg*              algorithm;
+   std::atomic<int>  next_start;
+   std::atomic<bool> cancel;
+   std::mutex        guess_lock;
+   std::mutex        best_lock;
+   Sol*              best;
+};
+
+typedef struct multistart_run_str MultiStartRun;
+
+
+static void copy_phase(Phases& target, Phases& source)
+{
+    target.nstates                     = source.nstates;
+    target.ncontrols                   = source.ncontrols;
+    target.nparameters                 = source.nparameters;
+    target.nobserved                   = source.nobserved;
+    target.nsamples                    = source.nsamples;
+    target.nevents                     = source.nevents;
+    target.npath                       = source.npath;
+    target.current_number_of_intervals = source.current_number_of_intervals;
+    target.bounds                      = source.bounds;
+    target.guess                       = source.guess;
+    target.nodes                       = source.nodes;
+    target.scale                       = source.scale;
+    target.zero_cost_integrand         = source.zero_cost_integrand;
+    target.covariance                  = source.covariance;
+    target.regularization_factor       = source.regularization_factor;
+    target.name                        = source.name;
+    target.units                       = source.units;
+
+    target.observation_map      = NULL;
+    target.observation_map_size = 0;
+
+    if (source.observation_map) {
+        // Observations read from a mapped binary file are not modified by the solver and
+        // are shared with the source, which keeps the mapping.
+        DMatrix& t = source.observation_nodes;
+        DMatrix& y = source.observations;
+        DMatrix& w = source.residual_weights;
+
+        target.observation_nodes.UseExternalArray(t.GetNoRows()*t.GetNoCols(), t.GetPr(), t.GetNoRows(), t.GetNoCols());
+        target.observations.UseExternalArray(y.GetNoRows()*y.GetNoCols(), y.GetPr(), y.GetNoRows(), y.GetNoCols());
+        target.residual_weights.UseExternalArray(w.GetNoRows()*w.GetNoCols(), w.GetPr(), w.GetNoRows(), w.GetNoCols());
+    }
+    else {
+        target.observation_nodes = source.observation_nodes;
+        target.observations      = source.observations;
+        target.residual_weights  = source.residual_weights;
+    }
+}
+
+
+void copy_problem(Prob& target, Prob& source)
+{
+    // Copies the definition of a problem which has gone through psopt_level2_setup() into a
+    // problem object which has not been set up, so that both can be solved independently.
+    // Names, units, user data and the fixed size evaluator are shared with the source.
+
+    int i;
+
+    if (target.phase != NULL) {
+        error_message("copy_problem(): the target problem has already been set up");
+    }
+
+    target.nphases                  = source.nphases;
+    target.scale                    = source.scale;
+    target.nlinkages                = source.nlinkages;
+    target.multi_segment_flag       = source.multi_segment_flag;
+    target.continuous_controls_flag = source.continuous_controls_flag;
+    target.bounds                   = source.bounds;
+    target.name                     = source.name;
+    target.outfilename              = source.outfilename;
+    target.user_data                = source.user_data;
+    target.endpoint_cost            = source.endpoint_cost;
+    target.integrand_cost           = source.integrand_cost;
+    target.dae                      = source.dae;
+    target.events                   = source.events;
+    target.linkages                 = source.linkages;
+    target.observation_function     = source.observation_function;
+    target.fixed_size               = source.fixed_size;
+
+    target.phase = new Phases[source.nphases];
+
+    for (i=0; i<source.nphases; i++) {
+        copy_phase(target.phase[i], source.phase[i]);
+    }
+}
+
+
+static void move_solution(Sol& target, Sol& source)
+{
+    // Moves the contents of source into target. The previous arrays of target are left in
+    // source, to be released by its destructor.
+
+    std::swap(target.states,           source.states);
+    std::swap(target.controls,         source.controls);
+    std::swap(target.nodes,            source.nodes);
+    std::swap(target.parameters,       source.parameters);
+    std::swap(target.relative_errors,  source.relative_errors);
+    std::swap(target.integrand_cost,   source.integrand_cost);
+    std::swap(target.endpoint_cost,    source.endpoint_cost);
+    std::swap(target.integrated_cost,  source.integrated_cost);
+    std::swap(target.mesh_stats,       source.mesh_stats);
+    std::swap(target.dual.Hamiltonian, source.dual.Hamiltonian);
+    std::swap(target.dual.costates,    source.dual.costates);
+    std::swap(target.dual.path,        source.dual.path);
+    std::swap(target.dual.events,      source.dual.events);
+    std::swap(target.dual.linkages,    source.dual.linkages);
+
+    target.xad                         = source.xad;
+    target.cost                        = source.cost;
+    target.nlp_return_code             = source.nlp_return_code;
+    target.cpu_time                    = source.cpu_time;
+    target.error_flag                  = source.error_flag;
+    target.error_msg                   = source.error_msg;
+    target.mesh_refinement_iterations  = source.mesh_refinement_iterations;
+    target.start_date_and_time         = source.start_date_and_time;
+    target.end_date_and_time           = source.end_date_and_time;
+    target.realtime_status             = source.realtime_status;
+    target.realtime_iterations         = source.realtime_iterations;
+    target.iteration_times             = source.iteration_times;
+    target.iteration_time_percentiles  = source.iteration_time_percentiles;
+}
+
+
+static void solve_start(int istart, MultiStartRun& run)
+{
+    MultiStart&      multistart = *run.multistart;
+    MultiStartStats& stats      = multistart.stats[istart-1];
+
+    Prob*  problem  = new Prob;
+    Sol*   solution = new Sol;
+    Alg    algorithm = *run.algorithm;
+    char   name[32];
+
+    solution->error_flag      = false;
+    solution->nlp_return_code = 0;
+    solution->cost            = 0.0;
+    solution->cpu_time        = 0.0;
+
+    try {
+        copy_problem(*problem, *run.problem);
+
+        sprintf(name, "start_%d", istart);
+
+        algorithm.output_directory = make_output_subdirectory(*run.algorithm, name);
+
+        if (multistart.guess) {
+            std::lock_guard<std::mutex> lock(run.guess_lock);
+            multistart.guess(*problem, istart, multistart.user_data);
+        }
+
+        Solver solver;
+
+        solver.cancel = &run.cancel;
+
+        psopt(solver, *solution, *problem, algorithm);
+    }
+    catch (ErrorHandler handler)
+    {
+        solution->error_msg  = handler.error_message;
+        solution->error_flag = true;
+    }
+
+    stats.nlp_return_code = solution->nlp_return_code;
+    stats.cost            = solution->cost;
+    stats.cpu_time        = solution->cpu_time;
+    stats.error_flag      = solution->error_flag;
+    stats.error_msg       = solution->error_msg;
+    stats.converged       = nlp_solve_converged(*solution, algorithm);
+    stats.cancelled       = ( run.cancel.load() && !stats.converged );
+
+    delete problem;
+
+    solution->problem = run.problem;
+
+    {
+        std::lock_guard<std::mutex> lock(run.best_lock);
+
+        bool better = false;
+
+        if (!solution->error_flag) {
+            if (run.best == NULL) {
+                better = true;
+            }
+            else {
+                bool best_converged = multistart.stats[multistart.best_start-1].converged;
+
+                if (stats.converged != best_converged)
+                    better = stats.converged;
+                else
+                    better = ( stats.cost < run.best->cost );
+            }
+        }
+
+        if (better) {
+            if (run.best) delete run.best;
+            run.best = solution;
+            multistart.best_start = istart;
+            solution = NULL;
+        }
+
+        if ( stats.converged && stats.cost <= multistart.target_cost ) {
+            run.cancel.store(true);
+        }
+    }
+
+    if (solution) delete solution;
+}
+
+
+static void run_starts(MultiStartRun& run)
+{
+    int istart;
+
+    while ( (istart = run.next_start.fetch_add(1)) <= run.multistart->nstarts ) {
+        if ( run.cancel.load() ) {
+            run.multistart->stats[istart-1].cancelled = true;
+        }
+        else {
+            solve_start(istart, run);
+        }
+    }
+}
+
+
+static void multistart_thread(MultiStartRun* run)
+{
+    // The temporary objects of the DMatrix class are thread local and need to be
+    // allocated in each worker thread.
+
+    InitializeDMatrixClass dmatrix_temporaries;
+
+    run_starts(*run);
+}
+
+
+static void psopt_multistart_main(MultiStart& multistart, Sol& solution, Prob& problem, Alg& algorithm)
+{
+// Solves the problem from multistart.nstarts initial guesses, each generated by
+// multistart.guess() on a private copy of the problem, and returns the best solution.
+// Converged starts are preferred to unconverged ones, and among them the one with the
+// lowest cost. Each start has its own workspace and ADOL-C tapes, and writes its output
+// files to the subdirectory start_<i> of algorithm.output_directory. Running starts in
+// several threads requires an ADOL-C library built with thread support (OpenMP) and a
+// thread safe linear solver in IPOPT.
+
+    int i;
+
+    if (multistart.nstarts < 1) {
+        error_message("psopt_multistart(): the number of starts must be positive");
+    }
+
+    if (problem.phase == NULL) {
+        error_message("psopt_multistart(): the problem has not been set up");
+    }
+
+    // Concurrent starts are opt-in, as they need a thread-enabled ADOL-C and a re-entrant
+    // IPOPT linear solver.
+    int nthreads = MAX( MIN(multistart.nthreads, multistart.nstarts), 1 );
+
+    if (multistart.stats) delete [] multistart.stats;
+
+    multistart.stats      = new MultiStartStats[multistart.nstarts];
+    multistart.best_start = 0;
+
+    for (i=0; i<multistart.nstarts; i++) {
+        MultiStartStats& stats = multistart.stats[i];
+        stats.start           = i+1;
+        stats.nlp_return_code = 0;
+        stats.cost            = 0.0;
+        stats.cpu_time        = 0.0;
+        stats.converged       = false;
+        stats.error_flag      = false;
+        stats.cancelled       = false;
+    }
+
+    MultiStartRun run;
+
+    run.multistart = &multistart;
+    run.problem    = &problem;
+    run.algorithm  = &algorithm;
+    run.next_start = 1;
+    run.cancel     = false;
+    run.best       = NULL;
+
+    if (nthreads == 1) {
+        run_starts(run);
+    }
+    else {
+        std::thread* threads = new std::thread[nthreads];
+
+        for (i=0; i<nthreads; i++) {
+            threads[i] = std::thread(multistart_thread, &run);
+        }
+
+        for (i=0; i<nthreads; i++) {
+            threads[i].join();
+        }
+
+        delete [] threads;
+    }
+
+    if (algorithm.print_level) {
+        fprintf(stderr, "\n>>> PSOPT multi-start summary\n");
+        fprintf(stderr, "\nStart\tStatus\t\tNLP return code\tCost\t\tCPU time (s)");
+
+        for (i=0; i<multistart.nstarts; i++) {
+            MultiStartStats& stats = multistart.stats[i];
+            const char* status = stats.converged ? "converged" : ( stats.cancelled ? "cancelled" : ( stats.error_flag ? "error" : "failed" ) );
+            fprintf(stderr, "\n%i\t%-9s\t%i\t\t%e\t%e", stats.start, status, stats.nlp_return_code, stats.cost, stats.cpu_time);
+        }
+
+        fprintf(stderr, "\n\nBest start:\t%i\n", multistart.best_start);
+    }
+
+    if (run.best == NULL) {
+        error_message("psopt_multistart(): none of the starts produced a solution");
+    }
+
+    move_solution(solution, *run.best);
+
+    solution.problem = &problem;
+
+    delete run.best;
+}
+
+
+void psopt_multistart(MultiStart& multistart, Sol& solution, Prob& problem, Alg& algorithm)
+{
+
+    try {
+           psopt_multistart_main(multistart, solution, problem, algorithm);
+    }
+    catch (ErrorHandler handler)
+    {
+           solution.error_msg = handler.error_message;
+           solution.error_flag = true;
+    }
+}
@@ -31,6 +31,224 @@ e-mail:    v.m.becerra@ieee.org
 
 #include "psopt.h"
 
+#include <stdint.h>
+
+#ifdef WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static cs* spline_observation_weights(const double* tnodes, int n, DMatrix& observation_nodes, int nsamples)
+{
+   // Natural cubic spline weights, four per sample, matching the evaluation made by get_interpolated_state()
+
+   int k, kleft, kright, kmid, nz = 0;
+
+   cs* W = cs_spalloc(2*n, nsamples, 4*nsamples, 1, 0);
+
+   for (k=0; k<nsamples; k++) {
+
+        double tv = observation_nodes(k+1);
+
+        kleft = 0; kright = n-1;
+        while (kright-kleft > 1) {
+             kmid = (kright+kleft)/2;
+             if (tnodes[kmid] > tv) kright=kmid;
+             else kleft=kmid;
+        }
+
+        double h = tnodes[kleft+1]-tnodes[kleft];
+        if (h == 0.0) error_message("Bad time data in trajectory interpolation");
+        double A = (tnodes[kleft+1]-tv)/h;
+        double B = (tv-tnodes[kleft])/h;
+
+        W->p[k] = nz;
+        W->i[nz] = kleft;     W->x[nz++] = A;
+        W->i[nz] = kleft+1;   W->x[nz++] = B;
+        W->i[nz] = n+kleft;   W->x[nz++] = (A*A*A-A)*(h*h)/6.0;
+        W->i[nz] = n+kleft+1; W->x[nz++] = (B*B*B-B)*(h*h)/6.0;
+   }
+
+   W->p[nsamples] = nz;
+
+   return W;
+}
+
+
+static cs* lagrange_observation_weights(const double* snodes, const double* bweights, int n, double t0, double tf, DMatrix& observation_nodes, int nsamples)
+{
+   // Barycentric Lagrange weights, n per sample or a single one if the sample falls on a node
+
+   int k, j, nz = 0;
+
+   cs* W = cs_spalloc(2*n, nsamples, n*nsamples, 1, 0);
+
+   for (k=0; k<nsamples; k++) {
+
+        double s = (2.0*observation_nodes(k+1) - (tf+t0))/(tf-t0);
+
+        W->p[k] = nz;
+
+        for (j=0; j<n; j++) {
+             if (s == snodes[j]) break;
+        }
+
+        if (j<n) {
+             W->i[nz] = j; W->x[nz++] = 1.0;
+             continue;
+        }
+
+        double den = 0.0;
+        for (j=0; j<n; j++) {
+             den += bweights[j]/(s-snodes[j]);
+        }
+        for (j=0; j<n; j++) {
+             W->i[nz] = j; W->x[nz++] = bweights[j]/(s-snodes[j])/den;
+        }
+   }
+
+   W->p[nsamples] = nz;
+
+   return W;
+}
+
+
+static bool phase_times_are_free(Phases& phase)
+{
+   return ( phase.bounds.lower.StartTime != phase.bounds.upper.StartTime || phase.bounds.lower.EndTime != phase.bounds.upper.EndTime );
+}
+
+
+static ObsWeights* get_observation_weights(int iphase, adouble* xad, Workspace* workspace)
+{
+   // Returns the interpolation weights of the observation instants of phase iphase, and builds the
+   // interpolants of its states and controls for xad. The weights are recomputed only when the mesh
+   // changes. NULL is returned if the phase times are free, as the weights then depend on xad.
+
+   int j, k;
+   int i = iphase-1;
+
+   Prob& problem   = *workspace->problem;
+   Alg&  algorithm = *workspace->algorithm;
+   Phases& phase   = problem.phases(iphase);
+
+   int norder    = phase.current_number_of_intervals;
+   int nstates   = phase.nstates;
+   int ncontrols = phase.ncontrols;
+   int nsamples  = phase.nsamples;
+   int n         = norder+1;
+
+   if ( phase_times_are_free(phase) ) {
+        return NULL;
+   }
+
+   double t0 = phase.bounds.lower.StartTime;
+   double tf = phase.bounds.lower.EndTime;
+
+   ObsWeights& w = workspace->obs_weights[i];
+
+   if ( w.mesh != workspace->current_mesh_refinement_iteration || w.npoints != n || w.t0 != t0 || w.tf != tf ) {
+
+        if (w.states)   cs_spfree(w.states);
+        if (w.controls) cs_spfree(w.controls);
+
+        double* snodes  = new double[n];
+        double* tnodes  = new double[n];
+
+        for (k=0; k<n; k++) {
+             snodes[k] = (workspace->snodes[i])(k+1);
+             tnodes[k] = convert_to_original_time( snodes[k], t0, tf );
+        }
+
+        w.lagrange = use_global_collocation(algorithm) && norder<100;
+
+        if (w.lagrange) {
+             double* bweights = new double[n];
+             collocation_barycentric_weights(snodes, bweights, n, workspace);
+             w.states = lagrange_observation_weights(snodes, bweights, n, t0, tf, phase.observation_nodes, nsamples);
+             delete [] bweights;
+        }
+        else {
+             w.states = spline_observation_weights(tnodes, n, phase.observation_nodes, nsamples);
+        }
+
+        w.controls = spline_observation_weights(tnodes, n, phase.observation_nodes, nsamples);
+
+        delete [] snodes;
+        delete [] tnodes;
+
+        w.mesh    = workspace->current_mesh_refinement_iteration;
+        w.npoints = n;
+        w.t0      = t0;
+        w.tf      = tf;
+   }
+
+   for (j=1; j<=nstates; j++) {
+        InterpCache& c = get_trajectory_interpolant(j, false, iphase, xad, workspace);
+        if (c.lagrange != w.lagrange || c.npoints != n) return NULL;
+   }
+
+   for (j=1; j<=ncontrols; j++) {
+        get_trajectory_interpolant(j, true, iphase, xad, workspace);
+   }
+
+   return &w;
+}
+
+
+static adouble weighted_nodal_sum(cs* W, int k, InterpCache& c)
+{
+   adouble v = 0.0;
+
+   int n = c.npoints;
+
+   for (int p=W->p[k]; p<W->p[k+1]; p++) {
+        int r = W->i[p];
+        v += W->x[p]*( r<n ? c.y[r] : c.d2y[r-n] );
+   }
+
+   return v;
+}
+
+
+static void interpolate_at_sample(adouble* interpolated_state, adouble* interpolated_control, int k, adouble& time_k, ObsWeights* weights, int iphase, adouble* xad, Workspace* workspace)
+{
+   // Values of the states and controls of phase iphase at observation instant k, obtained from the
+   // precomputed weights if available, otherwise by evaluating the interpolants at time_k.
+
+   int j;
+
+   Prob& problem = *workspace->problem;
+
+   int nstates   = problem.phases(iphase).nstates;
+   int ncontrols = problem.phases(iphase).ncontrols;
+
+   if (weights) {
+        InterpCache* c = workspace->interp_cache[iphase-1];
+        for (j=0; j<nstates; j++) {
+             interpolated_state[j] = weighted_nodal_sum(weights->states, k-1, c[j]);
+        }
+        for (j=0; j<ncontrols; j++) {
+             interpolated_control[j] = weighted_nodal_sum(weights->controls, k-1, c[nstates+j]);
+        }
+        return;
+   }
+
+   for (j=0; j<nstates; j++) {
+        get_interpolated_state(&interpolated_state[j], j+1,  iphase, time_k, xad, workspace);
+   }
+
+   for (j=0; j<ncontrols; j++) {
+        get_interpolated_control(&interpolated_control[j], j+1,  iphase, time_k, xad, workspace);
+   }
+}
+
+
 adouble endpoint_cost_for_parameter_estimation(adouble* initial_states, adouble* final_states, adouble* parameters,adouble& t0, adouble& tf, adouble* xad, int iphase, Workspace* workspace)
 {
    // This is the end point cost function for parameter estimation problems.
@@ -86,23 +304,14 @@ adouble endpoint_cost_for_parameter_estimation(adouble* initial_states, adouble*
 
 //   Lambda = V*Sqrt(D)*tra(V);  // Lambda is the square root of the covariance matrix.
 
+   ObsWeights* weights = get_observation_weights(iphase, xad, workspace);
 
    for(k=1; k<=nsamples;k++) {
 
         time_k = observation_nodes(k);
 
        // Interpolate states and controls to find values at measurement instants
-        for (j=0; j<problem.phases(iphase).nstates; j++) {
-
-   	            get_interpolated_state(&interpolated_state[j], j+1,  iphase, time_k, xad, workspace);
-
-   	    }
-
-        for (j=0; j<problem.phases(iphase).ncontrols; j++) {
-
-   	            get_interpolated_control(&interpolated_control[j], j+1,  iphase, time_k, xad, workspace);
-
-   	    }
+        interpolate_at_sample(interpolated_state, interpolated_control, k, time_k, weights, iphase, xad, workspace);
 
    	    // Evaluate the observations function
 
@@ -194,6 +403,146 @@ void auto_split_observations(Prob& problem, DMatrix& observation_nodes, DMatrix&
 
 
 
+// Binary observation files start with a 32 byte header: the 8 character tag "PSOPTOBS", the format
+// version and a reserved word (32 bit integers), and nsamples and nobserved (64 bit integers).
+// The header is followed by three column major blocks of doubles stored exactly as PSOPT keeps them
+// in memory: the sampling instants (1 x nsamples), the observations (nobserved x nsamples) and the
+// residual weights (nobserved x nsamples).
+
+#define OBSERVATION_FILE_TAG      "PSOPTOBS"
+#define OBSERVATION_FILE_VERSION  1
+#define OBSERVATION_HEADER_SIZE   32
+
+struct observation_file_header {
+    char      tag[8];
+    int32_t   version;
+    int32_t   reserved;
+    int64_t   nsamples;
+    int64_t   nobserved;
+};
+
+
+static void* map_observation_file(const char* filename, size_t* size)
+{
+    // Maps a whole file copy-on-write, so that the data are paged in on demand and never copied
+    // unless they are modified in memory. Returns NULL if the file cannot be mapped.
+
+    void* addr = NULL;
+
+#ifdef WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+
+    LARGE_INTEGER file_size;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+        if (mapping != NULL) {
+            addr = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+            CloseHandle(mapping);
+            *size = (size_t) file_size.QuadPart;
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        addr = mmap(NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) addr = NULL;
+        else *size = (size_t) st.st_size;
+    }
+    close(fd);
+#endif
+
+    return addr;
+}
+
+
+static void unmap_observation_file(void* addr, size_t size)
+{
+#ifdef WIN32
+    UnmapViewOfFile(addr);
+#else
+    munmap(addr, size);
+#endif
+}
+
+
+static bool is_binary_observation_file(const char* filename)
+{
+    char tag[8];
+
+    FILE* fp = fopen(filename, "rb");
+
+    if (fp == NULL) {
+        error_message("Error opening file in load_parameter_estimation_data()");
+    }
+
+    bool binary = ( fread(tag, 1, 8, fp) == 8 && memcmp(tag, OBSERVATION_FILE_TAG, 8) == 0 );
+
+    fclose(fp);
+
+    return binary;
+}
+
+
+void release_parameter_estimation_data(Phases& phase)
+{
+    // Detaches the observation arrays of a phase from a mapped binary file and unmaps the file.
+
+    if (phase.observation_map == NULL) return;
+
+    phase.observation_nodes.UseExternalArray(0, NULL, 0, 0);
+    phase.observations.UseExternalArray(0, NULL, 0, 0);
+    phase.residual_weights.UseExternalArray(0, NULL, 0, 0);
+
+    unmap_observation_file(phase.observation_map, phase.observation_map_size);
+
+    phase.observation_map = NULL;
+    phase.observation_map_size = 0;
+}
+
+
+static void load_binary_parameter_estimation_data(Phases& phase, const char* filename)
+{
+    char msg[256];
+
+    size_t size = 0;
+
+    void* addr = map_observation_file(filename, &size);
+
+    if (addr == NULL) {
+        error_message("Error mapping binary observation file in load_parameter_estimation_data()");
+    }
+
+    observation_file_header* header = (observation_file_header*) addr;
+
+    long nsamples  = phase.nsamples;
+    long nobserved = phase.nobserved;
+
+    long nvalues = nsamples*(2*nobserved + 1);
+
+    if ( size < OBSERVATION_HEADER_SIZE || header->version != OBSERVATION_FILE_VERSION ||
+         header->nsamples != nsamples || header->nobserved != nobserved ||
+         size != OBSERVATION_HEADER_SIZE + nvalues*sizeof(double) ) {
+        unmap_observation_file(addr, size);
+        sprintf(msg, "Binary observation file %.100s does not match nsamples=%ld and nobserved=%ld in load_parameter_estimation_data()", filename, nsamples, nobserved);
+        error_message(msg);
+    }
+
+    double* data = (double*) ((char*) addr + OBSERVATION_HEADER_SIZE);
+
+    phase.observation_map      = addr;
+    phase.observation_map_size = size;
+
+    phase.observation_nodes.UseExternalArray(nsamples, data, 1, nsamples);
+    phase.observations.UseExternalArray(nobserved*nsamples, data + nsamples, nobserved, nsamples);
+    phase.residual_weights.UseExternalArray(nobserved*nsamples, data + nsamples*(nobserved+1), nobserved, nsamples);
+}
+
+
 void load_parameter_estimation_data(Prob& problem, int iphase, const char* filename)
 {
     // This function reads data for parameter estimation problems for a given phase "iphase" from a file
@@ -203,6 +552,15 @@ void load_parameter_estimation_data(Prob& problem, int iphase, const char* filen
     // variable 1, and so on.
     // The dimensions of the matrix in the data file is  problem.phases(iphase).nsamples x 2*problem.phases(iphase).nobserved + 1
     //
+    // Binary files written by convert_parameter_estimation_data() are memory mapped instead, and the
+    // observation arrays of the phase use the mapping as storage without copying it.
+
+     release_parameter_estimation_data( problem.phases(iphase) );
+
+     if ( is_binary_observation_file(filename) ) {
+          load_binary_parameter_estimation_data( problem.phases(iphase), filename );
+          return;
+     }
 
      DMatrix data, tm, ym, w;
 
@@ -232,10 +590,77 @@ void load_parameter_estimation_data(Prob& problem, int iphase, const char* filen
 }
 
 
-
-void compute_residual_vector_in_phase(DMatrix& residual_vector, adouble* xad, int iphase, Workspace* workspace)
+void convert_parameter_estimation_data(const char* text_filename, const char* binary_filename, int nsamples, int nobserved)
 {
+    // Converts a text observation file in the format read by load_parameter_estimation_data() into the
+    // binary format, which can then be memory mapped by load_parameter_estimation_data().
+
+    char msg[256];
+
+    FILE* in = fopen(text_filename, "r");
+
+    if (in == NULL) {
+        error_message("Error opening text file in convert_parameter_estimation_data()");
+    }
+
+    long ns = nsamples;
+    long no = nobserved;
+
+    double* data = new double[ns*(2*no+1)];
+
+    double* tm = data;
+    double* ym = data + ns;
+    double* w  = data + ns*(no+1);
+
+    for (long k=0; k<ns; k++) {
+        bool ok = ( fscanf(in, "%lf", &tm[k]) == 1 );
+        for (long j=0; j<no && ok; j++) {
+            ok = ( fscanf(in, "%lf", &ym[k*no+j]) == 1 && fscanf(in, "%lf", &w[k*no+j]) == 1 );
+        }
+        if (!ok) {
+            fclose(in);
+            delete [] data;
+            sprintf(msg, "Error reading sample %ld of %.100s in convert_parameter_estimation_data()", k+1, text_filename);
+            error_message(msg);
+        }
+    }
+
+    fclose(in);
+
+    observation_file_header header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.tag, OBSERVATION_FILE_TAG, 8);
+    header.version   = OBSERVATION_FILE_VERSION;
+    header.nsamples  = ns;
+    header.nobserved = no;
 
+    FILE* out = fopen(binary_filename, "wb");
+
+    if (out == NULL) {
+        delete [] data;
+        error_message("Error opening binary file in convert_parameter_estimation_data()");
+    }
+
+    size_t nvalues = (size_t) (ns*(2*no+1));
+
+    bool ok = ( fwrite(&header, sizeof(header), 1, out) == 1 && fwrite(data, sizeof(double), nvalues, out) == nvalues );
+
+    fclose(out);
+
+    delete [] data;
+
+    if (!ok) {
+        error_message("Error writing binary file in convert_parameter_estimation_data()");
+    }
+}
+
+
+static void residuals_in_phase(adouble* rad, DMatrix* residual_vector, adouble* xad, int iphase, Workspace* workspace)
+{
+   // Computes the weighted residuals of the observations of phase iphase, ordered by sample.
+   // The residuals are returned as adoubles in rad and/or as values in residual_vector,
+   // whichever are not NULL.
 
    adouble time_k;
 
@@ -261,7 +686,7 @@ void compute_residual_vector_in_phase(DMatrix& residual_vector, adouble* xad, in
 
    adouble* resid = workspace->observed_residual[iphase-1];
 
-   residual_vector.Resize( nsamples*nobserved, 1);
+   if (residual_vector) residual_vector->Resize( nsamples*nobserved, 1);
 
    adouble* parameters;
 
@@ -269,22 +694,14 @@ void compute_residual_vector_in_phase(DMatrix& residual_vector, adouble* xad, in
 
    get_parameters(parameters, xad, iphase, workspace);
 
+   ObsWeights* weights = get_observation_weights(iphase, xad, workspace);
+
    for(k=1; k<=nsamples;k++) {
 
         time_k = observation_nodes(k);
 
        // Interpolate states and controls to find values at measurement instants
-        for (j=0; j<problem.phases(iphase).nstates; j++) {
-
-   	            get_interpolated_state(&interpolated_state[j], j+1,  iphase, time_k, xad, workspace);
-
-   	    }
-
-        for (j=0; j<problem.phases(iphase).ncontrols; j++) {
-
-   	            get_interpolated_control(&interpolated_control[j], j+1,  iphase, time_k, xad, workspace);
-
-   	    }
+        interpolate_at_sample(interpolated_state, interpolated_control, k, time_k, weights, iphase, xad, workspace);
 
    	    // Evaluate the observations function
 
@@ -297,7 +714,8 @@ void compute_residual_vector_in_phase(DMatrix& residual_vector, adouble* xad, in
              for (j=0;j<nobserved;j++) {
                 resid[j] = residual_weights(j+1,k)*( observed_variable[j] - observations(j+1, k) );
 
-		residual_vector( (k-1)*nobserved+j+1  ) = resid[j].value();
+		if (rad)             rad[(k-1)*nobserved+j] = resid[j];
+		if (residual_vector) (*residual_vector)( (k-1)*nobserved+j+1  ) = resid[j].value();
 
              }
 
@@ -307,25 +725,35 @@ void compute_residual_vector_in_phase(DMatrix& residual_vector, adouble* xad, in
 
    }
 
+}
 
 
-
+void compute_residual_vector_in_phase(DMatrix& residual_vector, adouble* xad, int iphase, Workspace* workspace)
+{
+   residuals_in_phase(NULL, &residual_vector, xad, iphase, workspace);
 }
 
 
-
-void rr_num(DMatrix& X, DMatrix* residual_vector, Workspace* workspace)
+int get_number_of_residuals(Prob& problem)
 {
+   int iphase;
 
+   int nr = 0;
 
+   for(iphase=1; iphase<=problem.nphases;iphase++)
+   {
+       nr += problem.phases(iphase).nobserved*problem.phases(iphase).nsamples;
+   }
 
-   adouble time_k;
+   return nr;
+}
 
-   int index, iphase, dindex, j,  k;
 
-   Prob & problem = *(workspace->problem);
+void rr_num(DMatrix& X, DMatrix* residual_vector, Workspace* workspace)
+{
+   int index, iphase, dindex, j;
 
-   adouble* parameters;
+   Prob & problem = *(workspace->problem);
 
    DMatrix residual_vector_in_phase;
 
@@ -337,34 +765,141 @@ void rr_num(DMatrix& X, DMatrix* residual_vector, Workspace* workspace)
       xad[j] = X(j+1);
    }
 
+   residual_vector->Resize( get_number_of_residuals(problem), 1);
+
    index = 0;
 
+   begin_interpolation_cache(workspace);
+
    for(iphase=1; iphase<=problem.nphases;iphase++)
    {
        dindex = problem.phases(iphase).nobserved*problem.phases(iphase).nsamples;
+       residual_vector_in_phase.Resize( dindex, 1);
+       compute_residual_vector_in_phase( residual_vector_in_phase, xad, iphase, workspace);
+       (*residual_vector)( colon(index+1, index + dindex), 1) = residual_vector_in_phase;
        index = index+ dindex;
    }
 
-   residual_vector->Resize( index, 1);
+   end_interpolation_cache(workspace);
 
-   index = 0;
+}
+
+
+void rr_ad(adouble* xad, adouble* rad, Workspace* workspace)
+{
+   // Computes the weighted residuals of the observations of all phases as adoubles.
+   // The trajectory interpolants are built once and shared by all the samples.
+
+   int iphase;
+
+   int index = 0;
+
+   Prob & problem = *(workspace->problem);
+
+   begin_interpolation_cache(workspace);
 
    for(iphase=1; iphase<=problem.nphases;iphase++)
    {
-       parameters    = workspace->parameters[iphase-1];
-       dindex = problem.phases(iphase).nobserved*problem.phases(iphase).nsamples;
-       residual_vector_in_phase.Resize( dindex, 1);
-       compute_residual_vector_in_phase( residual_vector_in_phase, xad, iphase, workspace);
-       (*residual_vector)( colon(index+1, index + dindex), 1) = residual_vector_in_phase;
-       index = index+ dindex;
+       residuals_in_phase(rad+index, NULL, xad, iphase, workspace);
+       index += problem.phases(iphase).nobserved*problem.phases(iphase).nsamples;
    }
 
+   end_interpolation_cache(workspace);
+}
 
 
-}
+int compute_sparse_residual_jacobian(double* x, double* r, Workspace* workspace)
+{
+   // Computes the Jacobian of the residual vector at x with ADOL-C. The residual function is
+   // taped once per mesh (the sample interpolation weights are constant for a given mesh),
+   // and the sparsity pattern and seed matrix of the first call are reused by later calls.
+   // If the times of any phase are free, the interval of each sample depends on x through
+   // branches that are not recorded in the tape, so the function is retaped on every call.
+   // The non-zero elements are returned in workspace->res_jac_rind, res_jac_cind and
+   // res_jac_values, and the residual vector in r if it is not NULL. Returns the number of
+   // non-zero elements.
+
+   Prob & problem = *(workspace->problem);
+
+   int i;
+
+   int n  = get_number_nlp_vars(problem, workspace);
+
+   int nr = get_number_of_residuals(problem);
+
+   int repeat = 1;
+
+   int nnz = 0;
+
+   int rc;
+
+   short tag = (short) workspace->tag_res;
+
+   double* rtmp = new double[MAX(nr,1)];
+
+   for(i=1;i<=problem.nphases;i++) {
+        if ( phase_times_are_free(problem.phases(i)) ) workspace->trace_res_done = false;
+   }
+
+   if (!workspace->trace_res_done) {
+
+        adouble* xad = workspace->xad;
+        adouble* rad = new adouble[MAX(nr,1)];
+
+        trace_on(tag);
+        for(i=0;i<n;i++)
+             xad[i] <<= x[i];
+
+        rr_ad(xad, rad, workspace);
 
+        for(i=0;i<nr;i++)
+             rad[i] >>= rtmp[i];
+        trace_off();
 
+        delete [] rad;
 
+        // Arrays allocated by ADOL-C using malloc()
+        if (workspace->res_jac_rind)   free(workspace->res_jac_rind);
+        if (workspace->res_jac_cind)   free(workspace->res_jac_cind);
+        if (workspace->res_jac_values) free(workspace->res_jac_values);
+
+        workspace->res_jac_rind   = NULL;
+        workspace->res_jac_cind   = NULL;
+        workspace->res_jac_values = NULL;
+
+        workspace->trace_res_done = true;
+
+        repeat = 0;
+   }
+   else {
+        rc = function(tag, nr, n, x, rtmp);
+
+        if (rc < 0) {
+            // The control flow recorded in the tape is not valid at x, so the function is retaped
+            delete [] rtmp;
+            workspace->trace_res_done = false;
+            return compute_sparse_residual_jacobian(x, r, workspace);
+        }
+   }
+
+   if (r) for(i=0;i<nr;i++) r[i] = rtmp[i];
+
+   delete [] rtmp;
+
+#ifdef ADOLC_VERSION_1
+   sparse_jac(tag, nr, n, repeat, x, &nnz, &workspace->res_jac_rind, &workspace->res_jac_cind, &workspace->res_jac_values);
+#endif
+
+#ifdef ADOLC_VERSION_2
+   int options[4];
+   options[0]=0; options[1]=0; options[2]=0;options[3]=0;
+   sparse_jac(tag, nr, n, repeat, x, &nnz, &workspace->res_jac_rind, &workspace->res_jac_cind, &workspace->res_jac_values, options);
+#endif
+
+   if (repeat==0) workspace->res_jac_nnz = nnz;
+
+   return workspace->res_jac_nnz;
+}
 
 
 
@@ -390,11 +925,12 @@ void get_scaled_decision_variables_and_bounds(DMatrix& x, DMatrix xlb, DMatrix x
 
 
 
-void extract_parameter_covariance(DMatrix& Cp, DMatrix& C, Workspace* workspace)
+static int get_parameter_variable_indices(DMatrix& Ip, Workspace* workspace)
 {
+     // Returns in Ip the (1-based) indices of the static parameters of all phases within
+     // the vector of NLP variables.
      int i, j, ii;
      Prob & problem = *(workspace->problem);
-     DMatrix Ip;
      int pcount = 0;
 
      for(i=0;i< problem.nphases; i++)
@@ -412,10 +948,7 @@ void extract_parameter_covariance(DMatrix& Cp, DMatrix& C, Workspace* workspace)
 	int nstates   = problem.phase[i].nstates;
         int ncontrols = problem.phase[i].ncontrols;
         int nparam    = problem.phase[i].nparameters;
-	int offset;
         int iphase_offset = get_iphase_offset(problem,i+1, workspace);
-	int nvars_phase_i = get_nvars_phase_i(problem,i, workspace);
-        int offset1 = (norder+1)*ncontrols;
         int offset2 = (norder+1)*(ncontrols+nstates);
 
 	for (ii=1;ii<=nparam;ii++) {
@@ -425,83 +958,132 @@ void extract_parameter_covariance(DMatrix& Cp, DMatrix& C, Workspace* workspace)
 	}
      }
 
-     Cp = C( Ip, Ip );
-
+     return pcount;
 }
 
 
+void extract_parameter_covariance(DMatrix& Cp, DMatrix& C, Workspace* workspace)
+{
+     DMatrix Ip;
 
+     get_parameter_variable_indices(Ip, workspace);
 
+     Cp = C( Ip, Ip );
 
-bool compute_parameter_statistics(DMatrix& Cp, DMatrix& p, DMatrix& plow, DMatrix& phigh, DMatrix& r, Workspace* workspace)
-{
-      DMatrix Jr, Jc;
+}
 
-      DMatrix X, XL, XU;
 
-      Prob & problem = *(workspace->problem);
+static void sparse_to_dense(DMatrix& A, const cs* S)
+{
+     int j, p;
 
-      adouble* xad = workspace->xad;
+     A.Resize(S->m, S->n);
 
-      int iphase, i, j;
+     A.FillWithZeros();
 
-      adouble* parameters;
+     for(j=0;j<S->n;j++) {
+        for(p=S->p[j];p<S->p[j+1];p++) {
+           A(S->i[p]+1, j+1) += S->x[p];
+        }
+     }
+}
 
-      int pcount = 0;
 
-      double alpha;
+static bool sparse_parameter_covariance(DMatrix& Cp, const cs* Jr, const cs* Jc, Workspace* workspace)
+{
+      // Computes the parameter block of the covariance matrix Z*inv(Z'*Jr'*Jr*Z)*Z', where the
+      // columns of Z are a basis of the null space of Jc. This matrix is the leading block of
+      // the inverse of the KKT matrix K = [ Jr'*Jr  Jc' ; Jc  0 ], so its parameter rows are
+      // found from a sparse LU factorisation of K with one solve per parameter, without
+      // forming Z. Returns false if K is (structurally or numerically) singular, so that the
+      // dense method should be used instead.
+
+      int i, j, k, p;
+
+      int nvar = Jc->n;
+      int mc   = Jc->m;
+      int nk   = nvar + mc;
+
+      cs* JrT = cs_transpose(Jr, 1);
+      cs* H   = cs_multiply(JrT, Jr);
+
+      cs* T = cs_spalloc(nk, nk, H->p[nvar] + 2*Jc->p[nvar] + 1, 1, 1);
+
+      for(j=0;j<nvar;j++) {
+         for(p=H->p[j];p<H->p[j+1];p++) {
+            cs_entry(T, H->i[p], j, H->x[p]);
+         }
+         for(p=Jc->p[j];p<Jc->p[j+1];p++) {
+            cs_entry(T, nvar+Jc->i[p], j, Jc->x[p]);
+            cs_entry(T, j, nvar+Jc->i[p], Jc->x[p]);
+         }
+      }
 
-      char* msg = new char[60];
+      cs* K = cs_compress(T);
 
-      sprintf(msg,"\n>>> Performing statistical analysis of estimated parameters...");
+      cs_spfree(T);
+      cs_spfree(H);
+      cs_spfree(JrT);
 
-	  psopt_print(workspace,msg);
+      css* S = cs_sqr(1, K, 0);
+      csn* N = (S != NULL) ? cs_lu(K, S, 1.0) : NULL;
 
+      bool ok = ( N != NULL );
 
-      for(i=0;i< problem.nphases; i++)
-      {
-         pcount+= problem.phase[i].nparameters;
+      if (ok) {
+         // Check the diagonal of U, which is the last entry of each of its columns
+         const cs* U = N->U;
+         double umax = 0.0;
+         for(k=0;k<nk;k++) umax = MAX( umax, fabs(U->x[U->p[k+1]-1]) );
+         for(k=0;k<nk;k++) {
+            if ( fabs(U->x[U->p[k+1]-1]) <= nk*DMatrix::GetEPS()*umax ) ok = false;
+         }
       }
 
-      int total_number_of_parameters = pcount;
+      if (!ok) {
+         cs_nfree(N);
+         cs_sfree(S);
+         cs_spfree(K);
+         return false;
+      }
 
-      DMatrix parameters_full(pcount,1);
+      DMatrix Ip;
 
-      pcount = 0;
-
-      for(i=0;i< problem.nphases; i++)
-      {
+      int np = get_parameter_variable_indices(Ip, workspace);
 
-	 int iphase = i+1;
-	 int npar = problem.phase[i].nparameters;
+      Cp.Resize(np, np);
 
-	 parameters    = workspace->parameters[iphase-1];
+      double* b = new double[nk];
+      double* w = new double[nk];
 
-	 get_parameters( parameters, xad, iphase, workspace );
+      for(k=1;k<=np;k++) {
+          for(i=0;i<nk;i++) b[i] = 0.0;
+          b[ (int) Ip(k) - 1 ] = 1.0;
 
-	 for(j=0; j< npar; j++) {
-	   parameters_full(pcount+j+1) = parameters[j].value();
-	 }
+          cs_ipvec(N->pinv, b, w, nk);
+          cs_lsolve(N->L, w);
+          cs_usolve(N->U, w);
+          cs_ipvec(S->q, w, b, nk);
 
-         pcount+= problem.phase[i].nparameters;
+          for(i=1;i<=np;i++) {
+             Cp(i,k) = b[ (int) Ip(i) - 1 ];
+          }
       }
 
-      int nvar = get_number_nlp_vars(problem, workspace);
-
-      X .Resize(nvar,1);
-      XL.Resize(nvar,1);
-      XU.Resize(nvar,1);
-
+      delete [] b;
+      delete [] w;
 
-      get_scaled_decision_variables_and_bounds(X, XL, XU, workspace);
-
-      compute_jacobian_of_residual_vector_with_respect_to_variables(Jr, X, XL, XU, workspace);
+      cs_nfree(N);
+      cs_sfree(S);
+      cs_spfree(K);
 
-      compute_jacobian_of_constraints_with_respect_to_variables(Jc, X, XL, XU, workspace);
+      return true;
+}
 
-	  rr_num(X,&r, workspace);
 
-	  p = parameters_full;
+static bool dense_parameter_covariance(DMatrix& Cp, DMatrix& Jr, DMatrix& Jc, Workspace* workspace)
+{
+      int i, j;
 
       DMatrix JcT(Jc.GetNoCols(),Jc.GetNoRows());
 
@@ -515,13 +1097,14 @@ bool compute_parameter_statistics(DMatrix& Cp, DMatrix& p, DMatrix& plow, DMatri
       integer N= JcT.GetNoCols();
       double* A = JcT.GetPr();
       integer LDA = M;
-      double* TAU = new double[MIN(M,N)];
       integer LWORK = 6*MAX(1,N);
-      double* WORK= new double[MAX(1,LWORK)];
       integer INFO;
 
       if ((M-N)<=0) return false;
 
+      double* TAU = new double[MIN(M,N)];
+      double* WORK= new double[MAX(1,LWORK)];
+
       dgeqrf_( &M, &N, A, &LDA, TAU, WORK, &LWORK, &INFO );
 
       DMatrix I2 = ( zeros(N,M-N) && eye(M-N) );
@@ -539,6 +1122,9 @@ bool compute_parameter_statistics(DMatrix& Cp, DMatrix& p, DMatrix& plow, DMatri
 
       dormqr_( &SIDE, &TRANS, &M, &N2, &K, A, &LDA, TAU, C, &LDC, WORK, &LWORK, &INFO, 1, 1);
 
+      delete [] TAU;
+      delete [] WORK;
+
       // Calculation of covariance matrix w.r.t all decision variables.
       // See the paper:
       // Kostina et al (2003) "Computation of covariance matrices for constrained parameter estimation
@@ -560,6 +1146,97 @@ bool compute_parameter_statistics(DMatrix& Cp, DMatrix& p, DMatrix& plow, DMatri
 
       extract_parameter_covariance(Cp, CC, workspace);
 
+      return true;
+}
+
+
+
+bool compute_parameter_statistics(DMatrix& Cp, DMatrix& p, DMatrix& plow, DMatrix& phigh, DMatrix& r, Workspace* workspace)
+{
+      DMatrix X, XL, XU;
+
+      Prob & problem = *(workspace->problem);
+
+      adouble* xad = workspace->xad;
+
+      int iphase, i, j;
+
+      adouble* parameters;
+
+      int pcount = 0;
+
+      double alpha;
+
+      sprintf(workspace->text,"\n>>> Performing statistical analysis of estimated parameters...");
+
+	  psopt_print(workspace,workspace->text);
+
+
+      for(i=0;i< problem.nphases; i++)
+      {
+         pcount+= problem.phase[i].nparameters;
+      }
+
+      int total_number_of_parameters = pcount;
+
+      DMatrix parameters_full(pcount,1);
+
+      pcount = 0;
+
+      for(i=0;i< problem.nphases; i++)
+      {
+
+	 int iphase = i+1;
+	 int npar = problem.phase[i].nparameters;
+
+	 parameters    = workspace->parameters[iphase-1];
+
+	 get_parameters( parameters, xad, iphase, workspace );
+
+	 for(j=0; j< npar; j++) {
+	   parameters_full(pcount+j+1) = parameters[j].value();
+	 }
+
+         pcount+= problem.phase[i].nparameters;
+      }
+
+      int nvar = get_number_nlp_vars(problem, workspace);
+
+      X .Resize(nvar,1);
+      XL.Resize(nvar,1);
+      XU.Resize(nvar,1);
+
+
+      get_scaled_decision_variables_and_bounds(X, XL, XU, workspace);
+
+      cs* Jr = compute_sparse_jacobian_of_residual_vector(X, XL, XU, workspace);
+
+      cs* Jc = compute_sparse_jacobian_of_active_constraints(X, XL, XU, workspace);
+
+	  rr_num(X,&r, workspace);
+
+	  p = parameters_full;
+
+      bool done = false;
+
+      if ( Jc->n - Jc->m > 0 ) {
+
+           done = sparse_parameter_covariance(Cp, Jr, Jc, workspace);
+
+           if (!done) {
+               DMatrix JrD, JcD;
+               sparse_to_dense(JrD, Jr);
+               sparse_to_dense(JcD, Jc);
+               done = dense_parameter_covariance(Cp, JrD, JcD, workspace);
+           }
+
+      }
+
+      cs_spfree(Jr);
+      cs_spfree(Jc);
+
+      if (!done) return false;
+
       // Compute confidence intervals
 
       alpha = 0.95; // 95% Confidence level
@@ -608,3 +1285,256 @@ bool compute_parameter_statistics(DMatrix& Cp, DMatrix& p, DMatrix& plow, DMatri
 
 }
 
+
+
+static cs* residual_jacobian_matrix(double* x, Workspace* workspace)
+{
+   // Returns the Jacobian of the residual vector in compressed column form
+
+   Prob & problem = *(workspace->problem);
+
+   int i;
+
+   int n  = get_number_nlp_vars(problem, workspace);
+
+   int nr = get_number_of_residuals(problem);
+
+   int nnz = compute_sparse_residual_jacobian(x, NULL, workspace);
+
+   cs* T = cs_spalloc(nr, n, MAX(nnz,1), 1, 1);
+
+   for(i=0;i<nnz;i++) {
+       cs_entry(T, workspace->res_jac_rind[i], workspace->res_jac_cind[i], workspace->res_jac_values[i]);
+   }
+
+   cs* J = cs_compress(T);
+
+   cs_spfree(T);
+
+   return J;
+}
+
+
+static adouble gauss_newton_remainder_ad(adouble* xad, double* lambda, double obj_factor, int m, Workspace* workspace)
+{
+   // Part of the Lagrangian whose Hessian is computed exactly when the Gauss-Newton
+   // option is used: the constraint terms and the regularisation term of the objective.
+
+   Prob & problem = *(workspace->problem);
+
+   adouble L = 0.0;
+
+   adouble* g = workspace->gad;
+
+   int i;
+
+   double sigma = ( problem.scale.objective != -1 ) ? problem.scale.objective : 1.0;
+
+   gg_ad(xad, g, workspace);
+
+   for(i=0; i<m ; i++) {
+	L += lambda[ i ]*g[ i ];
+   }
+
+   for(i=1; i<=problem.nphases; i++) {
+        adouble* parameters = workspace->parameters[i-1];
+        get_parameters(parameters, xad, i, workspace);
+        L += obj_factor*sigma*problem.phases(i).regularization_factor*dot(parameters, parameters, problem.phases(i).nparameters);
+   }
+
+   return L;
+}
+
+
+static int gauss_newton_remainder_hessian(double* x, double* lambda, double obj_factor, int m,
+                                          unsigned int** hess_ir, unsigned int** hess_jc, double** hess_values, Workspace* workspace)
+{
+   // Tapes gauss_newton_remainder_ad() and computes its sparse Hessian with ADOL-C.
+   // The arrays are allocated by ADOL-C, and should be released using free().
+
+   Prob & problem = *(workspace->problem);
+
+   int i, nnz;
+
+   int n = get_number_nlp_vars(problem, workspace);
+
+   adouble* xad = workspace->xad;
+
+   adouble Lad;
+
+   double L;
+
+   short tag = (short) workspace->tag_hess;
+
+   trace_on(tag);
+   for(i=0;i<n;i++)
+	xad[i] <<= x[i];
+   Lad = gauss_newton_remainder_ad(xad, lambda, obj_factor, m, workspace);
+   Lad >>= L;
+   trace_off();
+
+#ifdef ADOLC_VERSION_1
+   sparse_hess(tag, n, 0, x, &nnz, hess_ir, hess_jc, hess_values);
+#endif
+
+#ifdef ADOLC_VERSION_2
+   int options[2];
+   options[0]=1; options[1]=0;
+   sparse_hess(tag, n, 0, x, &nnz, hess_ir, hess_jc, hess_values, options);
+#endif
+
+   return nnz;
+}
+
+
+int gauss_newton_hessian_structure(double* x, Workspace* workspace)
+{
+   // Finds the sparsity pattern of the Gauss-Newton approximation of the Hessian of the
+   // Lagrangian, which is the union of the patterns of Jr'*Jr and of the Hessian of the
+   // remaining terms. The upper triangular elements are stored by columns, with sorted
+   // row indices, in workspace->hess_ir, hess_jc and hess_colptr. Returns the number of
+   // elements.
+
+   Prob & problem = *(workspace->problem);
+
+   int i, j, p, nnz;
+
+   int n = get_number_nlp_vars(problem, workspace);
+
+   int m = get_number_nlp_constraints(problem, workspace);
+
+   cs* J  = residual_jacobian_matrix(x, workspace);
+   cs* JT = cs_transpose(J, 1);
+   cs* H  = cs_multiply(JT, J);
+
+   unsigned int* hir = NULL;
+   unsigned int* hjc = NULL;
+   double*       hval = NULL;
+
+   int nnz_rem = gauss_newton_remainder_hessian(x, workspace->lambda->GetPr(), 1.0, m, &hir, &hjc, &hval, workspace);
+
+   cs* T = cs_spalloc(n, n, H->p[n] + nnz_rem + 1, 1, 1);
+
+   for(j=0;j<n;j++) {
+      for(p=H->p[j];p<H->p[j+1];p++) {
+         if (H->i[p] <= j) cs_entry(T, H->i[p], j, 1.0);
+      }
+   }
+
+   for(i=0;i<nnz_rem;i++) {
+      cs_entry(T, MIN(hir[i],hjc[i]), MAX(hir[i],hjc[i]), 1.0);
+   }
+
+   // Arrays allocated by ADOL-C using malloc()
+   free(hir);
+   free(hjc);
+   free(hval);
+
+   cs* P  = cs_compress(T);
+   cs_dupl(P);
+   // Transposing twice sorts the row indices
+   cs* PT = cs_transpose(P, 0);
+   cs* PS = cs_transpose(PT, 0);
+
+   nnz = PS->p[n];
+
+   reserve_hessian_storage(nnz, workspace);
+
+   if (workspace->hess_colptr) delete [] workspace->hess_colptr;
+
+   workspace->hess_colptr = new int[n+1];
+
+   for(j=0;j<=n;j++) workspace->hess_colptr[j] = PS->p[j];
+
+   for(j=0;j<n;j++) {
+      for(p=PS->p[j];p<PS->p[j+1];p++) {
+         workspace->hess_ir[p] = PS->i[p];
+         workspace->hess_jc[p] = j;
+      }
+   }
+
+   cs_spfree(J);
+   cs_spfree(JT);
+   cs_spfree(H);
+   cs_spfree(T);
+   cs_spfree(P);
+   cs_spfree(PT);
+   cs_spfree(PS);
+
+   return nnz;
+}
+
+
+static void add_hessian_element(int i, int j, double value, double* values, Workspace* workspace)
+{
+   // Adds value to element (i,j) of the Hessian pattern found by gauss_newton_hessian_structure().
+   // A non-zero value outside the pattern cannot be passed to the NLP solver and is an error.
+
+   int lo = workspace->hess_colptr[j];
+   int hi = workspace->hess_colptr[j+1]-1;
+
+   while (lo <= hi) {
+      int mid = (lo+hi)/2;
+      int row = (int) workspace->hess_ir[mid];
+      if (row == i) {
+          values[mid] += value;
+          return;
+      }
+      if (row < i) lo = mid+1;
+      else hi = mid-1;
+   }
+
+   if (value != 0.0) {
+      sprintf(workspace->text, "Gauss-Newton Hessian element (%d,%d) is outside the sparsity pattern detected at the initial point; use algorithm.hessian = \"exact\"", i+1, j+1);
+      error_message(workspace->text);
+   }
+}
+
+
+void gauss_newton_hessian_values(double* x, double obj_factor, double* lambda, int m, double* values, Workspace* workspace)
+{
+   // Computes the Gauss-Newton approximation of the Hessian of the Lagrangian:
+   //   obj_factor*sigma*2*Jr'*Jr + Hessian of the remaining terms (constraints and regularisation),
+   // where sigma is the objective scaling factor and Jr is found from the residual tape.
+
+   Prob & problem = *(workspace->problem);
+
+   int i, j, p;
+
+   int n = get_number_nlp_vars(problem, workspace);
+
+   int nnz = workspace->hess_colptr[n];
+
+   double sigma = ( problem.scale.objective != -1 ) ? problem.scale.objective : 1.0;
+
+   for(i=0;i<nnz;i++) values[i] = 0.0;
+
+   cs* J  = residual_jacobian_matrix(x, workspace);
+   cs* JT = cs_transpose(J, 1);
+   cs* H  = cs_multiply(JT, J);
+
+   for(j=0;j<n;j++) {
+      for(p=H->p[j];p<H->p[j+1];p++) {
+         if (H->i[p] <= j) add_hessian_element(H->i[p], j, 2.0*sigma*obj_factor*H->x[p], values, workspace);
+      }
+   }
+
+   cs_spfree(J);
+   cs_spfree(JT);
+   cs_spfree(H);
+
+   unsigned int* hir = NULL;
+   unsigned int* hjc = NULL;
+   double*       hval = NULL;
+
+   int nnz_rem = gauss_newton_remainder_hessian(x, lambda, obj_factor, m, &hir, &hjc, &hval, workspace);
+
+   for(i=0;i<nnz_rem;i++) {
+      add_hessian_element(MIN(hir[i],hjc[i]), MAX(hir[i],hjc[i]), hval[i], values, workspace);
+   }
+
+   // Arrays allocated by ADOL-C using malloc()
+   free(hir);
+   free(hjc);
+   free(hval);
+}
@@ -39,6 +39,37 @@ void psopt_print(Workspace* workspace, const char* msg)
 }
 
 
+void print_realtime_summary(Sol& solution, Workspace* workspace)
+{
+    // Computes and prints the time per iteration percentiles of a real-time re-solve
+
+    string status;
+
+    DMatrix& p = solution.iteration_time_percentiles;
+
+    p.Resize(4,1);
+
+    p(1) = percentile( solution.iteration_times, 50.0 );
+    p(2) = percentile( solution.iteration_times, 90.0 );
+    p(3) = percentile( solution.iteration_times, 99.0 );
+    p(4) = percentile( solution.iteration_times, 100.0 );
+
+    switch (solution.realtime_status) {
+        case REALTIME_CONVERGED:        status = "converged";           break;
+        case REALTIME_ITERATION_LIMIT:  status = "iteration limit";     break;
+        case REALTIME_DEADLINE_REACHED: status = "deadline reached";    break;
+        default:                        status = "NLP failed";          break;
+    }
+
+    sprintf(workspace->text,"\nReal-time re-solve status:\t\t\t\t%s", status.c_str());
+    psopt_print(workspace,workspace->text);
+    sprintf(workspace->text,"\nReal-time iterations:\t\t\t\t\t%i", solution.realtime_iterations);
+    psopt_print(workspace,workspace->text);
+    sprintf(workspace->text,"\nTime per iteration [s] (p50, p90, p99, max):\t%e %e %e %e\n", p(1), p(2), p(3), p(4));
+    psopt_print(workspace,workspace->text);
+}
+
+
 void print_iterations_summary(Prob& problem,Alg& algorithm,Sol& solution, Workspace* workspace)
 {
 
@@ -93,6 +124,9 @@ void print_iterations_summary(Prob& problem,Alg& algorithm,Sol& solution, Worksp
 
         fprintf(outfile,"\n__________________________________________________________________________________________________________________\n\n");
 
+        fprintf(outfile,"\nWorkspace memory (kB)\t\t\t\t\t\t\t\t\t%li\n",
+		get_workspace_footprint(problem, workspace)/1024);
+
 
 	fclose(outfile);
 
@@ -237,16 +271,16 @@ void print_psopt_summary(Prob& problem, Alg& algorithm, Sol& solution, Workspace
     FILE* outfile;
     string auxstr;
     string filename;
-    string mesh_stats_file = "mesh_statistics.txt";
+    string mesh_stats_file = get_output_file_name(algorithm, "mesh_statistics.txt");
     int i;
     DMatrix mv(1);
 
     if ( !algorithm.print_level ) return;
 
     if ( problem.outfilename == "" )
-       filename = "psopt.txt";
+       filename = get_output_file_name(algorithm, "psopt.txt");
     else
-       filename = problem.outfilename;
+       filename = get_output_file_name(algorithm, problem.outfilename);
     outfile = fopen( filename.c_str(), "w");
     fprintf(outfile,"\nPSOPT results summary");
     fprintf(outfile,"\n=====================\n");
@@ -322,18 +356,18 @@ void print_psopt_summary(Prob& problem, Alg& algorithm, Sol& solution, Workspace
 
 
 #ifndef WIN32
-    auxstr = "cat " + mesh_stats_file;
+    auxstr = "cat \"" + mesh_stats_file + "\"";
 #else
-	auxstr = "type " + mesh_stats_file;
+	auxstr = "type \"" + mesh_stats_file + "\"";
 #endif
 
     system(auxstr.c_str());
 
 
 #ifndef WIN32
-    auxstr = "cat " + filename;
+    auxstr = "cat \"" + filename + "\"";
 #else
-	auxstr = "type " + filename;
+	auxstr = "type \"" + filename + "\"";
 #endif
 
     system(auxstr.c_str());
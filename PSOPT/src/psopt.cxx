@@ -56,14 +56,50 @@ void psopt(Sol& solution, Prob& problem, Alg& algorithm)
 }
 
 
-void psopt_main(Sol& solution, Prob& problem, Alg& algorithm)
+void psopt(Solver& solver, Sol& solution, Prob& problem, Alg& algorithm)
+{
+// Solves the problem as psopt() does, but keeps the workspace in the solver
+// object so that the problem can be re-solved later with psopt_resolve().
+
+    try {
+           psopt_main(solution, problem, algorithm, &solver);
+    }
+    catch (ErrorHandler handler)
+    {
+           solution.error_msg = handler.error_message;
+           solution.error_flag = true;
+    }
+}
+
+
+void psopt_resolve(Solver& solver, Sol& solution, Prob& problem, Alg& algorithm, DMatrix* initial_state, double shift)
+{
+
+    try {
+           psopt_resolve_main(solver, solution, problem, algorithm, initial_state, shift );
+    }
+    catch (ErrorHandler handler)
+    {
+           solution.error_msg = handler.error_message;
+           solution.error_flag = true;
+    }
+}
+
+
+
+void psopt_main(Sol& solution, Prob& problem, Alg& algorithm, Solver* solver)
 {
 // PSOPT:  main algorithm
 
 int MAX_STANDARD_PS_NODES = 200;
 
 
-Workspace* workspace = new Workspace;
+// The workspace is value initialised, so that a workspace which is only partly set up
+// when an error is thrown can be destroyed, releasing its tape tags.
+
+std::unique_ptr<Workspace> workspace_owner( new Workspace() );
+
+Workspace* workspace = workspace_owner.get();
 
 string startup_message= "\n *******************************************************************************\n * This is PSOPT, an optimal control solver based on pseudospectral and local  *\n * collocation methods, together with large scale nonlinear programming        *";
 
@@ -90,17 +126,14 @@ string contact_notice=  "\n * The author can be contacted at his email address:
 
   int nlp_ncons;
   int nlp_neq;
-  int offset;
   int nphases = problem.nphases;
 
   int number_of_mesh_refinement_iterations = get_number_of_mesh_refinement_iterations(problem,algorithm);
 
 
-  int i, k;
+  int i;
   int iter_nodes;
   int hotflag = 0;
-  int x_phase_offset = 0;
-  int lam_phase_offset = 0;
 
 
 
@@ -121,6 +154,8 @@ string contact_notice=  "\n * The author can be contacted at his email address:
 
   initialize_workspace_vars(problem,algorithm,solution, workspace);
 
+  if (solver) workspace->cancel_flag = solver->cancel;
+
 
   if (problem.integrand_cost == NULL )  {
       for(i=1;i<=problem.nphases;i++) {
@@ -243,6 +278,10 @@ string contact_notice=  "\n * The author can be contacted at his email address:
 
     workspace->trace_f_done = false;
 
+    workspace->trace_res_done = false;
+
+    workspace->nlp_structure_done = false;
+
     workspace->nvars     = get_number_nlp_vars(problem, workspace);
 
     nlp_ncons           = get_number_nlp_constraints(problem, workspace);
@@ -363,6 +402,200 @@ string contact_notice=  "\n * The author can be contacted at his email address:
 
     workspace->enable_nlp_counters = false;
 
+    extract_nlp_solution(solution, problem, algorithm, workspace);
+
+    if (!useAutomaticDifferentiation(algorithm) && algorithm.nlp_method=="IPOPT")  {
+//          deleteIndexGroups( workspace->igroup, workspace->nvars );
+    }
+
+    evaluate_solution(problem, algorithm, solution, workspace);
+
+    if ( workspace->cancel_flag && workspace->cancel_flag->load() ) {
+         psopt_print(workspace,"\n>>> PSOPT: the solve has been cancelled, no further mesh refinement iterations\n");
+         break;
+    }
+
+    if ( algorithm.mesh_refinement == "automatic" ) {
+       // Check satisfaction of mesh refinement tolerance
+       int mr_phase_convergence_count = 0;
+       for ( i=0; i< problem.nphases; i++ ) {
+	    DMatrix& emax_history = workspace->emax_history[i];
+
+	    if ( emax_history( iter_nodes, 2 ) <= algorithm.ode_tolerance )
+	        mr_phase_convergence_count++;
+       }
+
+
+
+       if (mr_phase_convergence_count == problem.nphases ) {
+	    psopt_print(workspace,"\n>>> PSOPT: automatic mesh refinement iterations converged as the maximum");
+	    psopt_print(workspace,"\n>>> relative error in all phases is lower than algorithm.ode_tolerance\n");
+	    break; // break the iterations.
+       }
+
+    }
+
+    if (algorithm.mesh_refinement == "automatic" && iter_nodes>= algorithm.mr_min_extrapolation_points && use_global_collocation(algorithm) && iter_nodes<number_of_mesh_refinement_iterations  )
+    {
+
+	   // Calculate the next number of nodes for each phase
+	      compute_next_mesh_size( problem, algorithm, solution, workspace );
+
+    }
+
+
+  } // End of mesh refinement iterations loop
+
+  solution.cpu_time = toc();
+
+  get_local_time( solution.end_date_and_time );
+
+
+
+  if (algorithm.print_level>0) {
+
+    print_algorithm_summary(problem, algorithm, solution, workspace);
+
+    print_solution_summary(problem, algorithm, solution, workspace);
+
+    print_constraint_summary(problem, solution, workspace);
+
+    print_iterations_summary(problem,algorithm,solution, workspace);
+
+    print_iterations_summary_tex(problem,algorithm,solution, workspace);
+
+    print_psopt_summary(problem, algorithm, solution, workspace);
+
+  }
+
+
+  if (solver) {
+      // Keep the workspace alive for subsequent calls to psopt_resolve()
+      if (solver->workspace) delete solver->workspace;
+      solver->workspace = workspace_owner.release();
+      solver->number_of_resolves = 0;
+  }
+  
+  return;
+
+}
+
+
+
+void psopt_resolve_main(Solver& solver, Sol& solution, Prob& problem, Alg& algorithm, DMatrix* initial_state, double shift)
+{
+// Re-solves a problem previously solved with psopt(solver, solution, problem, algorithm)
+// after the user has modified the bounds held in the problem structure.
+// The mesh, scaling factors, ADOL-C tapes, sparsity patterns and index groups of the
+// last mesh refinement iteration are reused, and the previous primal and dual solution,
+// shifted forward in time by "shift", is used as the warm start. If initial_state is not
+// NULL, it replaces the states at the first node of the first phase in the warm start.
+// No mesh refinement is performed and the discretisation error is not re-evaluated.
+// If algorithm.realtime_mode is "yes", the NLP is stopped after algorithm.realtime_iter_max
+// iterations or when algorithm.realtime_deadline seconds have elapsed, and the best iterate
+// found is returned, with solution.realtime_status indicating how the re-solve ended.
+
+  Workspace* workspace = solver.workspace;
+
+  if (workspace == NULL) {
+      error_message("psopt_resolve(): the solver has not been initialised by a call to psopt(solver, solution, problem, algorithm)");
+  }
+
+  if ( workspace->problem != &problem || workspace->algorithm != &algorithm || workspace->solution != &solution ) {
+      error_message("psopt_resolve(): the problem, algorithm and solution objects must be those used to initialise the solver");
+  }
+
+  if ( initial_state != NULL && length(*initial_state) != problem.phase[0].nstates ) {
+      error_message("psopt_resolve(): incorrect dimensions of the initial state vector");
+  }
+
+  tic();
+
+  get_local_time( solution.start_date_and_time );
+
+  solution.error_flag = false;
+
+  workspace->cancel_flag = solver.cancel;
+
+  DMatrix& x0     = *workspace->x0;
+  DMatrix& lambda = *workspace->lambda;
+  DMatrix& xlb    = *workspace->xlb;
+  DMatrix& xub    = *workspace->xub;
+
+  MeshStats& mesh_stats = solution.mesh_stats[workspace->current_mesh_refinement_iteration-1];
+
+  mesh_stats.n_obj_evals      = 0;
+  mesh_stats.n_con_evals      = 0;
+  mesh_stats.n_jacobian_evals = 0;
+  mesh_stats.n_hessian_evals  = 0;
+  mesh_stats.n_ode_rhs_evals  = 0;
+
+  if (solver.retape) {
+      // The user has changed data which enters the problem functions as constants,
+      // so that the tapes and the sparsity information need to be regenerated.
+      workspace->trace_f_done       = false;
+      workspace->trace_res_done     = false;
+      workspace->nlp_structure_done = false;
+  }
+
+  // Define NLP bounds on the decision vector using the (possibly modified) problem bounds
+
+  define_nlp_bounds(xlb, xub, problem, algorithm, workspace);
+
+  // Shift the previous solution in time to define the warm start
+
+  shift_nlp_guess(x0, lambda, problem, algorithm, initial_state, shift, workspace);
+
+  solver.number_of_resolves++;
+
+  sprintf(workspace->text,"\nProblem:\t\t\t\t\t\t%s", problem.name.c_str());
+  psopt_print(workspace,workspace->text);
+  sprintf(workspace->text, "\nThis is re-solve number:\t\t\t\t%i", solver.number_of_resolves);
+  psopt_print(workspace,workspace->text);
+  sprintf(workspace->text, "\nTime shift of the warm start:\t\t\t\t%e\n", shift);
+  psopt_print(workspace,workspace->text);
+
+  workspace->enable_nlp_counters = true;
+
+  workspace->realtime_flag = ( algorithm.realtime_mode == "yes" && algorithm.nlp_method == "IPOPT" );
+
+  chronometer_tic(workspace);
+
+  NLP_interface( algorithm, &x0,  ff_num, gg_num, workspace->ncons,  0 , &xlb, &xub, &lambda, 1, 1, workspace, problem.user_data   );
+
+  mesh_stats.CPU_time = chronometer_toc(workspace);
+
+  workspace->enable_nlp_counters = false;
+
+  extract_nlp_solution(solution, problem, algorithm, workspace);
+
+  if (workspace->realtime_flag) {
+      print_realtime_summary(solution, workspace);
+      workspace->realtime_flag = false;
+  }
+
+  solution.cpu_time = toc();
+
+  get_local_time( solution.end_date_and_time );
+
+}
+
+
+void extract_nlp_solution(Sol& solution, Prob& problem, Alg& algorithm, Workspace* workspace)
+{
+// Copies the NLP solution held in the workspace into the solution structure, computes
+// the costate and multiplier estimates and stores the data needed to hot start the next NLP.
+
+    DMatrix& x0     = *workspace->x0;
+    DMatrix& lambda = *workspace->lambda;
+
+    int i, k;
+    int offset;
+    int nphases = problem.nphases;
+    int x_phase_offset   = 0;
+    int lam_phase_offset = 0;
+
+
     // Copy the resultant decision vector into the relevant solution variables.
 
     copy_decision_variables(solution, x0, problem, algorithm, workspace);
@@ -738,70 +971,6 @@ string contact_notice=  "\n * The author can be contacted at his email address:
          }
     }
 
-    if (!useAutomaticDifferentiation(algorithm) && algorithm.nlp_method=="IPOPT")  {
-//          deleteIndexGroups( workspace->igroup, workspace->nvars );
-    }
-
-    evaluate_solution(problem, algorithm, solution, workspace);
-
-    if ( algorithm.mesh_refinement == "automatic" ) {
-       // Check satisfaction of mesh refinement tolerance
-       int mr_phase_convergence_count = 0;
-       for ( i=0; i< problem.nphases; i++ ) {
-	    DMatrix& emax_history = workspace->emax_history[i];
-
-	    if ( emax_history( iter_nodes, 2 ) <= algorithm.ode_tolerance )
-	        mr_phase_convergence_count++;
-       }
-
-
-
-       if (mr_phase_convergence_count == problem.nphases ) {
-	    psopt_print(workspace,"\n>>> PSOPT: automatic mesh refinement iterations converged as the maximum");
-	    psopt_print(workspace,"\n>>> relative error in all phases is lower than algorithm.ode_tolerance\n");
-	    break; // break the iterations.
-       }
-
-    }
-
-    if (algorithm.mesh_refinement == "automatic" && iter_nodes>= algorithm.mr_min_extrapolation_points && use_global_collocation(algorithm) && iter_nodes<number_of_mesh_refinement_iterations  )
-    {
-
-	   // Calculate the next number of nodes for each phase
-	      compute_next_mesh_size( problem, algorithm, solution, workspace );
-
-    }
-
-
-  } // End of mesh refinement iterations loop
-
-  solution.cpu_time = toc();
-
-  get_local_time( solution.end_date_and_time );
-
-
-
-  if (algorithm.print_level>0) {
-
-    print_algorithm_summary(problem, algorithm, solution, workspace);
-
-    print_solution_summary(problem, algorithm, solution, workspace);
-
-    print_constraint_summary(problem, solution, workspace);
-
-    print_iterations_summary(problem,algorithm,solution, workspace);
-
-    print_iterations_summary_tex(problem,algorithm,solution, workspace);
-
-    print_psopt_summary(problem, algorithm, solution, workspace);
-
-  }
-
-
-  if (workspace) delete  workspace;
-  
-  return;
-
 }
 
 
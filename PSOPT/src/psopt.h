@@ -122,6 +122,8 @@ using namespace std;
 #endif
 
 #include <string>
+#include <atomic>
+#include <memory>
 using std::string;
 
 
@@ -153,6 +155,78 @@ class ADMatrix {
 };
 
 
+// Natural cubic spline through a table of points. The polynomial
+// coefficients of every interval are computed once by the constructor, so
+// the spline can be evaluated many times (e.g. from within the DAE's) at the
+// cost of an interval search, which starts from the interval found in the
+// previous call. As that interval is stored in the object, evaluation is not
+// thread safe: a spline must not be shared by threads of psopt_multistart()
+// or psopt_sweep(), each of which should build its own copy.
+
+class CubicSpline {
+  int n;
+  int hint;
+  double* xd;
+  double* a;
+  double* b;
+  double* c;
+  double* d;
+  int  FindInterval(double x);
+  CubicSpline(const CubicSpline& s);
+  CubicSpline& operator=(const CubicSpline& s);
+  public:
+  // Constructors
+  CubicSpline();
+  CubicSpline(DMatrix& xdata, DMatrix& ydata);
+  CubicSpline(const double* xdata, const double* ydata, int npoints);
+  // Destructor
+  ~CubicSpline();
+  void    Set(const double* xdata, const double* ydata, int npoints);
+  double  Evaluate(double x);
+  double  Derivative(double x);
+  adouble Evaluate(const adouble& x);
+  adouble Derivative(const adouble& x);
+  void    Evaluate(const double* x, double* y, int m);
+  void    Derivative(const double* x, double* dy, int m);
+  void    Evaluate(DMatrix& X, DMatrix& Y);
+  int     GetNoPoints() const { return n;}
+};
+
+
+// Two dimensional lookup table z = f(x,y) defined on a rectangular grid.
+// On construction the table is converted into one set of polynomial
+// coefficients per grid cell, equivalent to bilinear interpolation or to
+// 2D natural cubic spline interpolation (as in spline_2d_interpolation()),
+// so each evaluation costs an interval search on each axis, starting from the
+// cell found in the previous call, plus the evaluation of one polynomial.
+// Like CubicSpline, a table keeps that cell in the object and must not be
+// shared by threads of psopt_multistart() or psopt_sweep().
+
+class LookupTable2D {
+  int nx;
+  int ny;
+  int order;
+  int hintx;
+  int hinty;
+  double* xd;
+  double* yd;
+  double* coef;
+  LookupTable2D(const LookupTable2D& t);
+  LookupTable2D& operator=(const LookupTable2D& t);
+  public:
+  // Constructor
+  LookupTable2D(DMatrix& X, DMatrix& Y, DMatrix& Z, const string& method = "spline");
+  // Destructor
+  ~LookupTable2D();
+  double  Evaluate(double x, double y);
+  adouble Evaluate(const adouble& x, const adouble& y);
+  void    Evaluate(const double* x, const double* y, double* z, int m);
+  void    Evaluate(DMatrix& X, DMatrix& Y, DMatrix& Z);
+  int     GetNoPointsX() const { return nx;}
+  int     GetNoPointsY() const { return ny;}
+};
+
+
 class dual_str {
 public:
   DMatrix* Hamiltonian;
@@ -224,8 +298,8 @@ struct alg_str {
   string    defect_scaling;
   string    diff_matrix;
   string    parameter_statistics;
-  double    jac_sparsity_ratio;
-  double    hess_sparsity_ratio;
+  double    jac_sparsity_ratio;  // Obsolete: sparse storage now follows the detected sparsity pattern
+  double    hess_sparsity_ratio; // Obsolete
   int       print_level; // 1: detailed output on screen and files (default), 0: no output
   int       save_sparsity_pattern;
   int       nsteps_error_integration;
@@ -242,12 +316,23 @@ struct alg_str {
   string    mesh_refinement;
   int       switch_order;
   double    ipopt_max_cpu_time;
+  string    realtime_mode;      // "yes": psopt_resolve() stops after realtime_iter_max iterations or at the deadline
+  int       realtime_iter_max;
+  double    realtime_deadline;  // wall clock budget of a real-time re-solve in seconds
+  string    output_directory;   // directory for the files written by PSOPT and the NLP solver, "" for the current directory
 
 
 };
 
 typedef struct alg_str Alg;
 
+// Status flags returned in solution.realtime_status by real-time re-solves
+
+#define REALTIME_CONVERGED          0
+#define REALTIME_ITERATION_LIMIT    1
+#define REALTIME_DEADLINE_REACHED   2
+#define REALTIME_NLP_FAILED         3
+
 
 struct ulbounds_str {
 
@@ -355,6 +440,10 @@ struct phases_str {
 
    double  regularization_factor;
 
+   void*   observation_map;
+
+   size_t  observation_map_size;
+
    Name name;
 
    Units units;
@@ -363,6 +452,8 @@ struct phases_str {
 
 typedef struct phases_str Phases;
 
+void release_parameter_estimation_data(Phases& phase);
+
 
 struct prob_ul_bounds {
      DMatrix linkage;
@@ -382,17 +473,39 @@ typedef struct prob_bounds_str ProbBounds;
 typedef class work_str Workspace;
 
 
+// Interface of the compile-time fixed-size evaluation kernels, see fixed_size.h.
+// When problem.fixed_size points to an evaluator which is compatible with the
+// current mesh, the IPOPT interface evaluates the objective, constraints and
+// their first derivatives with it instead of the ADOL-C tapes.
+
+class fixed_size_str {
+public:
+   virtual ~fixed_size_str() {}
+   virtual bool   compatible(Workspace* workspace) = 0;
+   virtual int    jacobian_nnz() = 0;
+   virtual void   jacobian_structure(int* irow, int* jcol) = 0;
+   virtual double objective(const double* x, Workspace* workspace) = 0;
+   virtual void   gradient(const double* x, double* grad, Workspace* workspace) = 0;
+   virtual void   constraints(const double* x, double* g, Workspace* workspace) = 0;
+   virtual void   jacobian(const double* x, double* values, Workspace* workspace) = 0;
+};
+
+typedef class fixed_size_str FixedSizeEvaluator;
+
+
 class prob_str {
 public:
     
    prob_str()
    {
        phase = NULL;
+       fixed_size = NULL;
    }
    ~prob_str()
    {
        if (phase)
        {
+         for (int i=0; i<nphases; i++) release_parameter_estimation_data(phase[i]);
          delete [] phase;
        }
    }
@@ -431,6 +544,8 @@ public:
 
    void (*observation_function)(adouble* observed_variable, adouble* states, adouble* controls, adouble* parameters, adouble& time, int k, adouble* xad, int iphase, Workspace* workspace);
 
+   FixedSizeEvaluator* fixed_size;
+
 };
 
 typedef class prob_str Prob;
@@ -484,6 +599,10 @@ public:
    MeshStats*  mesh_stats;
    string   start_date_and_time;
    string   end_date_and_time;
+   int      realtime_status;
+   int      realtime_iterations;
+   DMatrix  iteration_times;
+   DMatrix  iteration_time_percentiles; // 50th, 90th and 99th percentiles and maximum
    Prob* problem;
    DMatrix& get_states_in_phase(int iphase);
    DMatrix& get_controls_in_phase(int iphase);
@@ -516,6 +635,75 @@ typedef struct {
 } GRWORK;
 
 
+// Interpolant of a single state or control trajectory. It is built once per
+// evaluation of the NLP functions and then shared by all the calls made by the
+// user functions through get_interpolated_state(), get_delayed_state(), etc.
+
+class interp_cache_str {
+public:
+   interp_cache_str()
+   {
+      epoch = -1; xad = NULL; npoints = 0; capacity = 0; hint = 0;
+      lagrange = false; weights_mesh = -1;
+      time = NULL; y = NULL; d2y = NULL; weights = NULL; snodes = NULL;
+   }
+   ~interp_cache_str()
+   {
+      if (time)    delete [] time;
+      if (y)       delete [] y;
+      if (d2y)     delete [] d2y;
+      if (weights) delete [] weights;
+      if (snodes)  delete [] snodes;
+   }
+   long     epoch;        // NLP function evaluation for which the interpolant was built
+   adouble* xad;          // decision vector used to build it
+   int      npoints;
+   int      capacity;
+   int      hint;         // last spline interval found, used to start the next search
+   bool     lagrange;     // barycentric Lagrange interpolant if true, natural cubic spline otherwise
+   int      weights_mesh; // mesh iteration for which the barycentric weights were computed
+   adouble  t0;
+   adouble  tf;
+   adouble* time;
+   adouble* y;
+   adouble* d2y;
+   double*  weights;
+   double*  snodes;
+};
+
+typedef class interp_cache_str InterpCache;
+
+
+// Weights that map the nodal values of the state and control trajectories of a phase to
+// their interpolated values at the observation instants. They only depend on the mesh and
+// on the (fixed) phase times, so they are computed once per mesh iteration. Column k of each
+// matrix holds the weights of sample k on the nodal values (rows 0 to npoints-1) and, for
+// spline interpolants, on the nodal second derivatives (rows npoints to 2*npoints-1).
+
+class obs_weights_str {
+public:
+   obs_weights_str()
+   {
+      mesh = -1; npoints = 0; t0 = 0.0; tf = 0.0; lagrange = false;
+      states = NULL; controls = NULL;
+   }
+   ~obs_weights_str()
+   {
+      if (states)   cs_spfree(states);
+      if (controls) cs_spfree(controls);
+   }
+   int      mesh;         // mesh iteration for which the weights were computed
+   int      npoints;
+   double   t0;
+   double   tf;
+   bool     lagrange;     // the state weights are barycentric Lagrange weights if true
+   cs*      states;
+   cs*      controls;
+};
+
+typedef class obs_weights_str ObsWeights;
+
+
 typedef struct {
   int nsegments;
   int nstates;
@@ -558,6 +746,8 @@ public:
    DMatrix*  xub;
    DMatrix*  x0;
    DMatrix*  lambda;
+   DMatrix*  zl;
+   DMatrix*  zu;
    DMatrix*  dual_costates;
    DMatrix*  dual_path;
    DMatrix*  dual_events;
@@ -620,17 +810,28 @@ public:
    int       jac_nnz;
    int       jac_nnzA;
    int       jac_nnzG;
+   int       hess_nnz;
    double*   nrm_row;
    unsigned int*      hess_ir;
    unsigned int*      hess_jc;
+   int*               hess_colptr;
+   unsigned int*      jac_rind;
+   unsigned int*      jac_cind;
+   double*            jac_ad_values;
+   unsigned int*      res_jac_rind;
+   unsigned int*      res_jac_cind;
+   double*            res_jac_values;
+   int                res_jac_nnz;
    unsigned int*      iGfun;
    unsigned int*      jGvar;
-   unsigned int*      iGfun1;
-   unsigned int*      jGvar1;
+   int*               G_map;
    unsigned int*      iGfun2;
    unsigned int*      jGvar2;
    int       use_constraint_scaling;
    int       F_nnz;
+   int       jac_capacity;
+   int       hess_capacity;
+   int       snopt_capacity;
    double*   G2;
    adouble*  xad;
    adouble*  gad;
@@ -672,6 +873,25 @@ public:
    double*    lambda_d;
    double*    fg;
    bool       trace_f_done;
+   bool       trace_res_done;
+   bool       nlp_structure_done;
+   bool       fixed_size_active;
+   InterpCache** interp_cache;
+   ObsWeights* obs_weights;
+   long       interp_epoch;
+   bool       interp_cache_active;
+   long       footprint;
+   bool       realtime_flag;
+   bool       realtime_deadline_reached;
+   bool       realtime_best_found;
+   bool       realtime_best_feasible;
+   double     realtime_start;
+   double     realtime_last;
+   double     realtime_best_obj;
+   double     realtime_best_inf;
+   int        realtime_niter;
+   DMatrix*   realtime_best_x;
+   DMatrix*   realtime_iteration_times;
    IGroup*    igroup;
    char       text[2000];
    FILE*      psopt_solution_summary_file;
@@ -690,10 +910,137 @@ public:
   int tag_hess 	;
   int tag_fg 	;
   int tag_gc    ;
+  int tag_res   ;
+  int tape_tag_block = -1;   // no tape tags until initialize_workspace_vars()
   void *user_data;
+  std::atomic<bool>* cancel_flag; // when set, the solve stops at the next NLP iteration
+
+};
+
+
+// Persistent solver object. It keeps the workspace of a solved problem alive
+// (tapes, sparsity patterns, index groups and the last primal/dual solution)
+// so that the same problem can be solved again cheaply with psopt_resolve(),
+// for example in receding horizon (MPC) applications.
+
+class solver_str {
+public:
+   solver_str()
+   {
+      workspace = NULL;
+      retape    = false;
+      number_of_resolves = 0;
+      cancel    = NULL;
+   }
+   ~solver_str()
+   {
+      if (workspace) delete workspace;
+   }
+   Workspace* workspace;
+   bool       retape;
+   int        number_of_resolves;
+   std::atomic<bool>* cancel;   // optional flag which another thread may set to stop the solve
+};
+
+typedef class solver_str Solver;
+
+
+// Multi-start solves, see psopt_multistart(). The guess function is called with a
+// private copy of the problem before each start and sets its initial guess; starts are
+// numbered from 1. Starts run one at a time by default; with nthreads > 1 they run
+// concurrently, which needs an ADOL-C build with thread support and a re-entrant IPOPT
+// linear solver. The remaining starts are cancelled as soon as a start converges with a
+// cost not greater than target_cost. The best solution is returned together with the
+// statistics of every start.
 
+typedef struct {
+   int     start;
+   int     nlp_return_code;
+   double  cost;
+   double  cpu_time;
+   bool    converged;
+   bool    error_flag;
+   bool    cancelled;
+   string  error_msg;
+} MultiStartStats;
+
+class multistart_str {
+public:
+   multistart_str()
+   {
+      nstarts     = 0;
+      nthreads    = 1;
+      target_cost = -1.0e19;   // -inf: run all starts
+      guess       = NULL;
+      user_data   = NULL;
+      best_start  = 0;
+      stats       = NULL;
+   }
+   ~multistart_str()
+   {
+      if (stats) delete [] stats;
+   }
+   int     nstarts;
+   int     nthreads;
+   double  target_cost;
+   void  (*guess)(Prob& problem, int istart, void* user_data);
+   void*   user_data;
+   int     best_start;        // 0 if no start produced a solution
+   MultiStartStats* stats;    // nstarts entries
+};
+
+typedef class multistart_str MultiStart;
+
+
+// Parameter sweeps, see psopt_sweep(). Before each case set_case() is called with the
+// problem of the continuation chain which solves it and the value of the swept scalar.
+// The cases are ordered by value and split into nchains chains of neighbouring values.
+// The first case of a chain is solved from the user guess, and each following case is
+// warm started from the previous one, reusing its mesh, primal/dual solution, tapes and
+// sparsity patterns. Set retape to true if set_case() changes data which enters the
+// problem functions as constants rather than bounds. Chains run one at a time by default;
+// with nthreads > 1 they run concurrently, see psopt_sweep().
+
+typedef struct {
+   int     chain;
+   bool    warm_start;
+   int     nlp_return_code;
+   double  cost;
+   double  cpu_time;
+   bool    converged;
+   bool    error_flag;
+   string  error_msg;
+} SweepStats;
+
+class sweep_str {
+public:
+   sweep_str()
+   {
+      nchains   = 1;
+      nthreads  = 1;
+      retape    = false;
+      set_case  = NULL;
+      user_data = NULL;
+      solutions = NULL;
+      stats     = NULL;
+   }
+   ~sweep_str()
+   {
+      if (solutions) delete [] solutions;
+      if (stats) delete [] stats;
+   }
+   DMatrix values;
+   int     nchains;
+   int     nthreads;
+   bool    retape;
+   void  (*set_case)(Prob& problem, double value, int ichain, void* user_data);
+   void*   user_data;
+   Sol*    solutions;   // one per element of values, in the same order
+   SweepStats* stats;
 };
 
+typedef class sweep_str Sweep;
+
 
 
 struct xad_str {
@@ -714,9 +1061,9 @@ void ScalarGradientAD( adouble (*fun)(adouble *, Workspace*), DMatrix& x, DMatri
 void EfficientlyComputeJacobianNonZeros( void fun(DMatrix& x, DMatrix* f, Workspace* ), DMatrix& x,
                 int nf, double *nzvalue, int nnz, int* iArow, int* jAcol, IGroup* igroup, GRWORK* grw, Workspace* workspace );
 
-void compute_jacobian_of_constraints_with_respect_to_variables(DMatrix& Jc, DMatrix& X, DMatrix& XL, DMatrix& XU, Workspace* workspace);
+cs* compute_sparse_jacobian_of_active_constraints(DMatrix& X, DMatrix& XL, DMatrix& XU, Workspace* workspace);
 
-void compute_jacobian_of_residual_vector_with_respect_to_variables(DMatrix& Jr, DMatrix& X, DMatrix& XL, DMatrix& XU, Workspace* workspace);
+cs* compute_sparse_jacobian_of_residual_vector(DMatrix& X, DMatrix& XL, DMatrix& XU, Workspace* workspace);
 
 void getIndexGroups( IGroup* igroup, int nrows, int ncols, int nnz, int* iArow, int* jAcol, Workspace* workspace);
 
@@ -726,6 +1073,16 @@ void deleteIndexGroups(IGroup* igroup, int ncols );
 
 void psopt(Sol& solution, Prob& problem, Alg& algorithm);
 
+void psopt(Solver& solver, Sol& solution, Prob& problem, Alg& algorithm);
+
+void psopt_resolve(Solver& solver, Sol& solution, Prob& problem, Alg& algorithm, DMatrix* initial_state, double shift);
+
+void psopt_multistart(MultiStart& multistart, Sol& solution, Prob& problem, Alg& algorithm);
+
+void psopt_sweep(Sweep& sweep, Prob& problem, Alg& algorithm);
+
+void copy_problem(Prob& target, Prob& source);
+
 void psopt_level2_setup(Prob& problem, Alg& algorithm);
 
 void initialize_solution(Sol& solution, Prob& problem, Alg& algorithm, Workspace* workspace);
@@ -752,12 +1109,28 @@ void  define_nlp_bounds(DMatrix& xlb,DMatrix&  xub,Prob& problem, Alg& algorithm
 
 double convert_to_original_time(double tbar,double t0,double tf);
 
+string get_output_file_name(Alg& algorithm, const string& filename);
+
+string make_output_subdirectory(Alg& algorithm, const string& name);
+
+bool nlp_solve_converged(Sol& solution, Alg& algorithm);
+
 void resize_solution(Sol& solution, Prob& problem, Alg& algorithm);
 
 void hot_start_nlp_guess(DMatrix& x0,DMatrix& lambda, Sol& solution,Prob& problem,Alg& algorithm, DMatrix* prev_states, DMatrix* prev_controls, DMatrix* prev_costates, DMatrix* prev_path, DMatrix* prev_nodes, DMatrix* prev_param, DMatrix& prev_t0, DMatrix& prev_tf, Workspace* workspace );
 
 void lagrange_interpolation(DMatrix& y, DMatrix& x, DMatrix& pointx, DMatrix& pointy);
 
+void lagrange_interpolation(DMatrix& y, DMatrix& x, DMatrix& pointx, DMatrix& pointy, DMatrix& w);
+
+void barycentric_interpolation(double* y, const double* x, int m, const double* pointx, const double* pointy, const double* w, int n);
+
+void lgl_barycentric_weights(const double* x, double* w, int n);
+
+void cgl_barycentric_weights(double* w, int n);
+
+void pseudospectral_barycentric_weights(DMatrix& nodes, DMatrix& w, Alg& algorithm);
+
 double smooth_fabs(double x, double eps);
 
 adouble smooth_fabs(adouble x, double eps);
@@ -806,6 +1179,16 @@ void get_controls_bar(adouble* controls_bar, adouble* xad, int iphase, int k, Wo
 
 void rr_num(DMatrix& X, DMatrix* residual_vector, Workspace* workspace);
 
+void rr_ad(adouble* xad, adouble* rad, Workspace* workspace);
+
+int get_number_of_residuals(Prob& problem);
+
+int compute_sparse_residual_jacobian(double* x, double* r, Workspace* workspace);
+
+int gauss_newton_hessian_structure(double* x, Workspace* workspace);
+
+void gauss_newton_hessian_values(double* x, double obj_factor, double* lambda, int m, double* values, Workspace* workspace);
+
 void extract_parameter_covariance(DMatrix& Cp, DMatrix& C, Workspace* workspace);
 
 
@@ -835,9 +1218,7 @@ int NLP_interface(
 void ScalarGradient( double (*fun)(DMatrix& x, Workspace*), DMatrix& x,DMatrix* grad, GRWORK* grw, Workspace* workspace );
 
 void DetectJacobianSparsity(void fun(DMatrix& x, DMatrix* f, Workspace* ), DMatrix& x, int nf,
-                           int* nnzA, int* iArow, int* jAcol, double* Aij,
-                           int* nnzG, int* jGrow, int* jGcol,
-                           GRWORK* grw, Workspace* workspace);
+                           int* nnzA, int* nnzG, GRWORK* grw, Workspace* workspace);
 
 void ComputeJacobianNonZeros( void fun(DMatrix& x, DMatrix* f ), DMatrix& x, int nf, double *nzvalue, int nnz, int* iArow, int* jAcol, GRWORK* grw, Workspace* workspace );
 
@@ -848,6 +1229,14 @@ void initialize_workspace_vars(Prob& problem, Alg& algorithm, Sol& solution, Wor
 
 void resize_workspace_vars(Prob& problem, Alg& algorithm, Sol& solution, Workspace* workspace);
 
+long get_workspace_footprint(Prob& problem, Workspace* workspace);
+
+void reserve_jacobian_storage(int nnz, Workspace* workspace);
+
+void reserve_hessian_storage(int nnz, Workspace* workspace);
+
+void reserve_snopt_jacobian_storage(int nnz, Workspace* workspace);
+
 int get_number_nlp_vars(Prob& problem, Workspace* workspace);
 
 int get_number_nlp_constraints(Prob& problem, Workspace* workspace);
@@ -896,6 +1285,14 @@ void get_state_derivative(adouble* state_derivative, int state_index, int iphase
 
 void get_control_derivative(adouble* control_derivative, int control_index, int iphase, adouble& time, adouble* xad, Workspace* workspace);
 
+void begin_interpolation_cache(Workspace* workspace);
+
+InterpCache& get_trajectory_interpolant(int index, bool is_control, int iphase, adouble* xad, Workspace* workspace);
+
+void collocation_barycentric_weights(const double* snodes, double* weights, int n, Workspace* workspace);
+
+void end_interpolation_cache(Workspace* workspace);
+
 int get_number_of_controls(Prob& problem, int iphase);
 
 int get_number_of_states(Prob& problem,int iphase);
@@ -914,6 +1311,10 @@ int get_number_of_phases(Prob& problem);
 
 void lagrange_interpolation_ad(adouble* y, adouble& x, adouble* pointx, adouble* pointy, int npoints, Workspace* workspace);
 
+void barycentric_weights(const double* x, double* w, int n);
+
+void spline_second_derivative(adouble* x, adouble* y, int n,  adouble* d2y, Workspace* workspace);
+
 void linear_interpolation(adouble* y, adouble& x, adouble* pointx, adouble* pointy, int npoints);
 
 void linear_interpolation(DMatrix& y, double x, DMatrix& pointx, DMatrix& pointy, int npoints);
@@ -947,6 +1348,10 @@ void gg_num( DMatrix& x, DMatrix* g, Workspace* workspace );
 
 void fg_ad( adouble* x, adouble* fg, Workspace* workspace);
 
+void fg_num( DMatrix& x, DMatrix* fg, Workspace* workspace );
+
+void map_snopt_jacobian_elements(int neG, int nvars, Workspace* workspace);
+
 void compute_derivatives_trajectory( DMatrix& Xdot, Prob& problem, Sol& solution,  int i, Workspace* workspace );
 
 adouble integrate( adouble (*integrand)(adouble*,adouble*,adouble*,adouble&,adouble*,int, Workspace* workspace), adouble* xad, int i, Workspace* workspace );
@@ -995,7 +1400,17 @@ void validate_user_input(Prob& problem, Alg& algorithm, Workspace* workspace);
 
 void print_psopt_summary(Prob& problem, Alg& algorithm, Sol& solution, Workspace* workspace);
 
-void psopt_main(Sol& solution, Prob& problem, Alg& algorithm);
+void psopt_main(Sol& solution, Prob& problem, Alg& algorithm, Solver* solver=NULL);
+
+void psopt_resolve_main(Solver& solver, Sol& solution, Prob& problem, Alg& algorithm, DMatrix* initial_state, double shift);
+
+void print_realtime_summary(Sol& solution, Workspace* workspace);
+
+void extract_nlp_solution(Sol& solution, Prob& problem, Alg& algorithm, Workspace* workspace);
+
+void shift_node_values(DMatrix& v, int offset, int nrows, int npoints, DMatrix& time, DMatrix& shifted_time, bool use_lagrange, const bool* linear_rows=NULL);
+
+void shift_nlp_guess(DMatrix& x0, DMatrix& lambda, Prob& problem, Alg& algorithm, DMatrix* initial_state, double shift, Workspace* workspace);
 
 void clip_vector_given_bounds(DMatrix& xp, DMatrix& xlb, DMatrix& xub);
 
@@ -1047,6 +1462,10 @@ void   chronometer_tic(Workspace* workspace);
 
 double chronometer_toc(Workspace* workspace);
 
+double get_wall_clock_time();
+
+double percentile(DMatrix& x, double p);
+
 void print_iterations_summary(Prob& problem,Alg& algorithm,Sol& solution, Workspace* workspace);
 
 void print_iterations_summary_tex(Prob& problem,Alg& algorithm,Sol& solution, Workspace* workspace);
@@ -1062,6 +1481,7 @@ void transpose_ad(adouble* Apr, int na, int ma,  adouble* Atpr);
 void resample_trajectory(DMatrix& Y, DMatrix& X, DMatrix& Ydata, DMatrix& Xdata);
 
 void load_parameter_estimation_data(Prob& problem, int iphase, const char* filename);
+void convert_parameter_estimation_data(const char* text_filename, const char* binary_filename, int nsamples, int nobserved);
 
 bool compute_parameter_statistics(DMatrix& Qp, DMatrix& p, DMatrix& plow, DMatrix& phigh, DMatrix& r, Workspace* workspace);
 
@@ -1118,6 +1538,9 @@ int dormqr_(char *side, char *trans, integer *m, integer *n,
 }
 
 
+#include "fixed_size.h"
+
+
 
 #ifdef USE_SNOPT
 extern "C" {
@@ -1135,7 +1558,12 @@ void snPSOPTusrf_
 }
 
 
-extern Workspace* tempsnoptworkspace;
+// The workspace of a solve is passed to snPSOPTusrf_() through SNOPT's integer user
+// array iu, which holds a copy of the Workspace pointer.
+
+#define SNOPT_WORKSPACE_IU_LENGTH  ( (int) ( (sizeof(Workspace*)+sizeof(int)-1)/sizeof(int) ) )
+
+void set_snopt_user_workspace(int* iu, Workspace* workspace);
 
 
 
@@ -43,6 +43,8 @@ void psopt_level1_setup(Prob& problem)
        problem.phase[i].nsamples    = 0;
        problem.phase[i].zero_cost_integrand = false;
        problem.phase[i].regularization_factor = 0.0;
+       problem.phase[i].observation_map = NULL;
+       problem.phase[i].observation_map_size = 0;
    }
 
 
@@ -147,6 +149,10 @@ void psopt_level2_setup(Prob& problem, Alg& algorithm)
   algorithm.parameter_statistics        = "yes";
   algorithm.parameter_estimation_norm   = 2;
   algorithm.ipopt_max_cpu_time          = 3600.0;
+  algorithm.realtime_mode               = "no";
+  algorithm.realtime_iter_max           = 10;
+  algorithm.realtime_deadline           = INF;
+  algorithm.output_directory            = "";
 
 
   problem.multi_segment_flag = false;
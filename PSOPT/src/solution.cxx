@@ -134,6 +134,9 @@ void initialize_solution(Sol& solution, Prob& problem, Alg& algorithm, Workspace
    solution.error_flag = false;
    solution.error_msg = "";
 
+   solution.realtime_status     = REALTIME_CONVERGED;
+   solution.realtime_iterations = 0;
+
    solution.mesh_stats = new MeshStats[ get_number_of_mesh_refinement_iterations(problem,algorithm)];
    for (i=0;i<get_number_of_mesh_refinement_iterations(problem,algorithm) ; i++)
    {
@@ -0,0 +1,358 @@
+/*********************************************************************************************
+
+This file is part of the PSOPT library, a software tool for computational optimal control
+
+Copyright (C) 2009-2020 Victor M. Becerra
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA,
+or visit http://www.gnu.org/licenses/
+
+Author:    Professor Victor M. Becerra
+Address:   University of Portsmouth
+           School of Energy and Electronic Engineering
+           Portsmouth PO1 3DJ
+           United Kingdom
+e-mail:    v.m.becerra@ieee.org
+
+**********************************************************************************************/
+
+
+
+#include "psopt.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+
+// State shared by the threads of a parameter sweep
+
+struct sweep_run_str {
+   Sweep*            sweep;
+   Prob*             problem;
+   Alg*              algorithm;
+   int               nchains;
+   std::vector<int>  order;         // case indices sorted by value
+   std::atomic<int>  next_chain;
+};
+
+typedef struct sweep_run_str SweepRun;
+
+
+static DMatrix* copy_matrices(DMatrix* source, int n)
+{
+    if (source == NULL) return NULL;
+
+    DMatrix* target = new DMatrix[n];
+
+    for (int i=0; i<n; i++) target[i] = source[i];
+
+    return target;
+}
+
+
+static double* copy_doubles(double* source, int n)
+{
+    if (source == NULL) return NULL;
+
+    double* target = new double[n];
+
+    memcpy(target, source, n*sizeof(double));
+
+    return target;
+}
+
+
+static void copy_solution(Sol& target, Sol& source, Prob& problem, Alg& algorithm)
+{
+    // Copies a solution into a solution object which does not hold one yet
+
+    int nphases = problem.nphases;
+    int nmesh   = get_number_of_mesh_refinement_iterations(problem, algorithm);
+
+    target.states               = copy_matrices(source.states, nphases);
+    target.controls             = copy_matrices(source.controls, nphases);
+    target.nodes                = copy_matrices(source.nodes, nphases);
+    target.parameters           = copy_matrices(source.parameters, nphases);
+    target.relative_errors      = copy_matrices(source.relative_errors, nphases);
+    target.integrand_cost       = copy_matrices(source.integrand_cost, nphases);
+    target.dual.Hamiltonian     = copy_matrices(source.dual.Hamiltonian, nphases);
+    target.dual.costates        = copy_matrices(source.dual.costates, nphases);
+    target.dual.path            = copy_matrices(source.dual.path, nphases);
+    target.dual.events          = copy_matrices(source.dual.events, nphases);
+    target.endpoint_cost        = copy_doubles(source.endpoint_cost, nphases);
+    target.integrated_cost      = copy_doubles(source.integrated_cost, nphases);
+
+    if (source.dual.linkages) {
+        target.dual.linkages    = new DMatrix;
+        *target.dual.linkages   = *source.dual.linkages;
+    }
+
+    if (source.mesh_stats) {
+        target.mesh_stats       = new MeshStats[nmesh];
+        for (int i=0; i<nmesh; i++) target.mesh_stats[i] = source.mesh_stats[i];
+    }
+
+    target.cost                        = source.cost;
+    target.nlp_return_code             = source.nlp_return_code;
+    target.cpu_time                    = source.cpu_time;
+    target.error_flag                  = source.error_flag;
+    target.error_msg                   = source.error_msg;
+    target.start_date_and_time         = source.start_date_and_time;
+    target.end_date_and_time           = source.end_date_and_time;
+    target.realtime_status             = source.realtime_status;
+    target.realtime_iterations         = source.realtime_iterations;
+    target.iteration_times             = source.iteration_times;
+    target.iteration_time_percentiles  = source.iteration_time_percentiles;
+}
+
+
+static void solve_chain(int ichain, SweepRun& run)
+{
+    // Solves the cases of a continuation chain in order of increasing value. A case is
+    // warm started from the previous one with psopt_resolve(); if there is no previous
+    // solution, or the warm start fails or throws, the case is solved with psopt() instead.
+
+    Sweep& sweep  = *run.sweep;
+    int    ncases = (int) length(sweep.values);
+    int    first  = ( (ichain-1)*ncases )/run.nchains;
+    int    last   = ( ichain*ncases )/run.nchains;
+    int    k;
+
+    Prob*   problem  = new Prob;
+    Alg     algorithm = *run.algorithm;
+    Solver* solver   = NULL;
+    Sol*    solution = NULL;
+    char    name[32];
+
+    try {
+        copy_problem(*problem, *run.problem);
+
+        if (run.nchains > 1) {
+            sprintf(name, "chain_%d", ichain);
+            algorithm.output_directory = make_output_subdirectory(*run.algorithm, name);
+        }
+    }
+    catch (ErrorHandler handler)
+    {
+        for (k=first; k<last; k++) {
+            SweepStats& stats = sweep.stats[ run.order[k] ];
+            stats.error_flag  = true;
+            stats.error_msg   = handler.error_message;
+            sweep.solutions[ run.order[k] ].error_flag = true;
+            sweep.solutions[ run.order[k] ].error_msg  = handler.error_message;
+        }
+        delete problem;
+        return;
+    }
+
+    for (k=first; k<last; k++) {
+
+        int          icase = run.order[k];
+        SweepStats&  stats = sweep.stats[icase];
+        bool         warm  = ( solver != NULL );
+
+        stats.chain = ichain;
+
+        try {
+            if (sweep.set_case) {
+                sweep.set_case(*problem, sweep.values(icase+1), ichain, sweep.user_data);
+            }
+
+            if (warm) {
+                solver->retape = sweep.retape;
+
+                try {
+                    psopt_resolve(*solver, *solution, *problem, algorithm, NULL, 0.0);
+
+                    warm = nlp_solve_converged(*solution, algorithm);
+                }
+                catch (ErrorHandler handler)
+                {
+                    // Retried cold below
+                    warm = false;
+                }
+            }
+
+            if (!warm) {
+                if (solver)   delete solver;
+                if (solution) delete solution;
+
+                solver   = new Solver;
+                solution = new Sol;
+
+                solution->error_flag      = false;
+                solution->nlp_return_code = 0;
+                solution->cost            = 0.0;
+                solution->cpu_time        = 0.0;
+
+                psopt(*solver, *solution, *problem, algorithm);
+            }
+        }
+        catch (ErrorHandler handler)
+        {
+            if (solution == NULL) solution = new Sol;
+            solution->error_msg  = handler.error_message;
+            solution->error_flag = true;
+        }
+
+        stats.warm_start      = warm;
+        stats.error_flag      = solution->error_flag;
+        stats.error_msg       = solution->error_msg;
+        stats.converged       = nlp_solve_converged(*solution, algorithm);
+
+        if (!solution->error_flag) {
+            stats.nlp_return_code = solution->nlp_return_code;
+            stats.cost            = solution->cost;
+            stats.cpu_time        = solution->cpu_time;
+
+            copy_solution(sweep.solutions[icase], *solution, *problem, algorithm);
+        }
+        else {
+            sweep.solutions[icase].error_flag = true;
+            sweep.solutions[icase].error_msg  = solution->error_msg;
+        }
+
+        sweep.solutions[icase].problem = run.problem;
+
+        if ( solution->error_flag || solver == NULL || solver->workspace == NULL ) {
+            // Nothing to warm start the next case from
+            if (solver)   delete solver;
+            if (solution) delete solution;
+            solver   = NULL;
+            solution = NULL;
+        }
+    }
+
+    if (solver)   delete solver;
+    if (solution) delete solution;
+
+    delete problem;
+}
+
+
+static void run_chains(SweepRun& run)
+{
+    int ichain;
+
+    while ( (ichain = run.next_chain.fetch_add(1)) <= run.nchains ) {
+        solve_chain(ichain, run);
+    }
+}
+
+
+static void sweep_thread(SweepRun* run)
+{
+    // The temporary objects of the DMatrix class are thread local and need to be
+    // allocated in each worker thread.
+
+    InitializeDMatrixClass dmatrix_temporaries;
+
+    run_chains(*run);
+}
+
+
+void psopt_sweep(Sweep& sweep, Prob& problem, Alg& algorithm)
+{
+// Solves the problem for each value in sweep.values by continuation, see the description
+// of class sweep_str in psopt.h. The solution and statistics of case i are returned in
+// sweep.solutions[i-1] and sweep.stats[i-1]. When several chains are used, the output
+// files of chain i are written to the subdirectory chain_<i> of algorithm.output_directory.
+// Running chains in several threads requires an ADOL-C library built with thread support
+// (OpenMP) and a thread safe linear solver in IPOPT, and set_case() must not modify data
+// shared between chains.
+
+    int i;
+
+    int ncases = (int) length(sweep.values);
+
+    if (ncases < 1) {
+        error_message("psopt_sweep(): no values to sweep");
+    }
+
+    if (problem.phase == NULL) {
+        error_message("psopt_sweep(): the problem has not been set up");
+    }
+
+    if (sweep.solutions) delete [] sweep.solutions;
+    if (sweep.stats)     delete [] sweep.stats;
+
+    sweep.solutions = new Sol[ncases];
+    sweep.stats     = new SweepStats[ncases];
+
+    SweepRun run;
+
+    run.sweep      = &sweep;
+    run.problem    = &problem;
+    run.algorithm  = &algorithm;
+    run.nchains    = MAX( MIN(sweep.nchains, ncases), 1 );
+    run.next_chain = 1;
+
+    for (i=0; i<ncases; i++) {
+        SweepStats& stats     = sweep.stats[i];
+        stats.chain           = 0;
+        stats.warm_start      = false;
+        stats.nlp_return_code = 0;
+        stats.cost            = 0.0;
+        stats.cpu_time        = 0.0;
+        stats.converged       = false;
+        stats.error_flag      = false;
+
+        sweep.solutions[i].error_flag = false;
+        sweep.solutions[i].problem    = &problem;
+
+        run.order.push_back(i);
+    }
+
+    // Neighbouring values are solved one after the other so that each warm start is close
+
+    DMatrix& values = sweep.values;
+
+    std::stable_sort( run.order.begin(), run.order.end(), [&values](int a, int b) { return values(a+1) < values(b+1); } );
+
+    // Concurrent chains are opt-in, as they need a thread-enabled ADOL-C and a re-entrant
+    // IPOPT linear solver.
+    int nthreads = MAX( MIN(sweep.nthreads, run.nchains), 1 );
+
+    if (nthreads == 1) {
+        run_chains(run);
+    }
+    else {
+        std::thread* threads = new std::thread[nthreads];
+
+        for (i=0; i<nthreads; i++) {
+            threads[i] = std::thread(sweep_thread, &run);
+        }
+
+        for (i=0; i<nthreads; i++) {
+            threads[i].join();
+        }
+
+        delete [] threads;
+    }
+
+    if (algorithm.print_level) {
+        fprintf(stderr, "\n>>> PSOPT parameter sweep summary\n");
+        fprintf(stderr, "\nCase\tValue\t\tChain\tStart\tStatus\t\tCost\t\tCPU time (s)");
+
+        for (i=0; i<ncases; i++) {
+            SweepStats& stats = sweep.stats[i];
+            const char* status = stats.converged ? "converged" : ( stats.error_flag ? "error" : "failed" );
+            fprintf(stderr, "\n%i\t%e\t%i\t%s\t%-9s\t%e\t%e", i+1, values(i+1), stats.chain, stats.warm_start ? "warm" : "cold", status, stats.cost, stats.cpu_time);
+        }
+
+        fprintf(stderr, "\n");
+    }
+}
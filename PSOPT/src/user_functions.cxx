@@ -33,168 +33,296 @@ e-mail:    v.m.becerra@ieee.org
 
 
 
-void get_delayed_control(adouble* delayed_control, int control_index, int iphase, adouble& time, double delay, adouble* xad, Workspace* workspace)
+void begin_interpolation_cache(Workspace* workspace)
 {
+// Marks the start of an evaluation of the NLP functions. Trajectory interpolants
+// built from now on are shared by all the calls to the functions below until
+// end_interpolation_cache() is called.
 
- int k;
- int i = iphase-1;
- Prob& problem = *workspace->problem;
- int norder = problem.phase[i].current_number_of_intervals;
- adouble t0, tf;
- adouble delayed_time;
- adouble* time_array = workspace->time_array_tmp;;
- adouble* single_control_traj = workspace->single_trajectory_tmp;
- get_individual_control_trajectory(single_control_traj, control_index, iphase, xad, workspace);
- get_times( &t0, &tf, xad, iphase, workspace);
- for (k=1; k<=norder+1; k++) {
-	time_array[k-1]  =  convert_to_original_time_ad( (workspace->snodes[i])(k), t0, tf );
- }
- if ( time-delay>t0 ) // Careful because this if-then statement may not be differentiable
-        delayed_time= time-delay;
- else
-          delayed_time=t0; // what is best to do here?
+ workspace->interp_epoch++;
 
- spline_interpolation( delayed_control, delayed_time, time_array, single_control_traj, norder+1, workspace);
+ workspace->interp_cache_active = true;
+}
 
+void end_interpolation_cache(Workspace* workspace)
+{
+ workspace->interp_cache_active = false;
 }
 
-void get_delayed_state(adouble* delayed_state, int state_index, int iphase, adouble& time, double delay, adouble* xad, Workspace* workspace)
+void collocation_barycentric_weights(const double* snodes, double* weights, int n, Workspace* workspace)
 {
+// Barycentric weights of the Lagrange interpolant through the collocation nodes snodes
+
+ Alg& algorithm = *workspace->algorithm;
+
+ if (algorithm.collocation_method == "Legendre")
+      lgl_barycentric_weights(snodes, weights, n);
+ else if (algorithm.collocation_method == "Chebyshev")
+      cgl_barycentric_weights(weights, n);
+ else
+      barycentric_weights(snodes, weights, n);
+}
+
+InterpCache& get_trajectory_interpolant(int index, bool is_control, int iphase, adouble* xad, Workspace* workspace)
+{
+// Returns the interpolant of state (or control) number index of phase iphase. The
+// interpolant is only rebuilt if it was not built during the current evaluation of
+// the NLP functions with the same decision vector xad.
 
  int k;
- int i= iphase-1;
+ int i = iphase-1;
  Prob& problem = *workspace->problem;
  Alg&  algorithm=*workspace->algorithm;
- int norder = problem.phase[i].current_number_of_intervals;
- adouble t0, tf;
- double ts;
- adouble delayed_time;
- adouble* time_array = workspace->time_array_tmp;
- adouble* single_state_traj =  workspace->single_trajectory_tmp;
- get_individual_state_trajectory(single_state_traj, state_index, iphase, xad, workspace);
- get_times( &t0, &tf, xad, iphase, workspace);
- for (k=1; k<=norder+1; k++) {
-        ts = (workspace->snodes[i])(k);
-	time_array[k-1]  =  convert_to_original_time_ad( ts, t0, tf );
+ int norder    = problem.phase[i].current_number_of_intervals;
+ int nstates   = problem.phase[i].nstates;
+ int ncontrols = problem.phase[i].ncontrols;
+ int n         = norder+1;
+
+ if (workspace->interp_cache[i] == NULL) {
+     workspace->interp_cache[i] = new InterpCache[nstates+ncontrols];
  }
- if ( time-delay>t0 )
-        delayed_time= time-delay;
+
+ InterpCache& c = workspace->interp_cache[i][ is_control ? nstates+index-1 : index-1 ];
+
+ if ( workspace->interp_cache_active && c.epoch == workspace->interp_epoch && c.xad == xad && c.npoints == n ) {
+     return c;
+ }
+
+ if (c.capacity < n) {
+     if (c.time)    delete [] c.time;
+     if (c.y)       delete [] c.y;
+     if (c.d2y)     delete [] c.d2y;
+     if (c.weights) delete [] c.weights;
+     if (c.snodes)  delete [] c.snodes;
+     c.time    = new adouble[n];
+     c.y       = new adouble[n];
+     c.d2y     = new adouble[n];
+     c.weights = new double[n];
+     c.snodes  = new double[n];
+     c.capacity     = n;
+     c.weights_mesh = -1;
+ }
+
+ if (is_control)
+     get_individual_control_trajectory(c.y, index, iphase, xad, workspace);
  else
-          delayed_time=t0; // nothing best to do here...
+     get_individual_state_trajectory(c.y, index, iphase, xad, workspace);
+
+ get_times( &c.t0, &c.tf, xad, iphase, workspace);
 
- if ( use_global_collocation(algorithm) &&  norder<100  ) {
- 	lagrange_interpolation_ad( delayed_state, delayed_time, time_array, single_state_traj, norder+1, workspace);
+ c.lagrange = !is_control && use_global_collocation(algorithm) && norder<100;
+
+ if (c.lagrange) {
+     // The barycentric weights only depend on the nodes, so they are kept for the whole mesh iteration
+     if (c.weights_mesh != workspace->current_mesh_refinement_iteration || c.npoints != n) {
+         for (k=1; k<=n; k++) {
+              c.snodes[k-1] = (workspace->snodes[i])(k);
+         }
+         collocation_barycentric_weights(c.snodes, c.weights, n, workspace);
+         c.weights_mesh = workspace->current_mesh_refinement_iteration;
+     }
  }
- else if ( workspace->differential_defects == "Hermite-Simpson" || workspace->differential_defects == "trapezoidal" ) {
-	spline_interpolation( delayed_state, delayed_time, time_array, single_state_traj, norder+1, workspace);
+ else {
+     for (k=1; k<=n; k++) {
+         c.time[k-1] = convert_to_original_time_ad( (workspace->snodes[i])(k), c.t0, c.tf );
+     }
+     spline_second_derivative(c.time, c.y, n, c.d2y, workspace);
+     c.hint = 0;
  }
 
+ c.npoints = n;
+ c.epoch   = workspace->interp_epoch;
+ c.xad     = xad;
+
+ return c;
 }
 
-void get_interpolated_state(adouble* interp_state, int state_index, int iphase, adouble& time, adouble* xad, Workspace* workspace)
+static void evaluate_interpolant(InterpCache& c, adouble& time, adouble* value, adouble* derivative)
 {
+// Evaluates the interpolant and/or its time derivative at the given time
+
+ int j, k;
+ int n = c.npoints;
+
+ if (c.lagrange) {
+     // Second (true) form of the barycentric formula in the normalised time s in [-1,1],
+     // O(n) per evaluation.
+     adouble s  = (2.0*time - (c.tf+c.t0))/(c.tf-c.t0);
+     double  sv = s.value();
+     int     hit = -1;
+
+     for (j=0; j<n; j++) {
+         if ( fabs(sv-c.snodes[j]) <= sqrt(DMatrix::GetEPS()) ) {
+              hit = j;
+              break;
+         }
+     }
 
- int k;
- int i = iphase-1;
- Prob& problem = *workspace->problem;
- Alg&  algorithm=*workspace->algorithm;
- int norder = problem.phase[i].current_number_of_intervals;
- adouble t0, tf;
- double ts;
-
- adouble* time_array = workspace->time_array_tmp;
- adouble* single_state_traj =  workspace->single_trajectory_tmp;
- get_individual_state_trajectory(single_state_traj, state_index, iphase, xad, workspace);
- get_times( &t0, &tf, xad, iphase, workspace);
- for (k=1; k<=norder+1; k++) {
-        ts = (workspace->snodes[i])(k);
-	time_array[k-1]  =  convert_to_original_time_ad( ts, t0, tf );
- }
+     // Near a node the first and second derivatives of the interpolating polynomial at
+     // the node are used, see Berrut and Trefethen (2004), SIAM Review 46(3), eq. (9.4).
+     // They carry the dependence on s (and so on the time and the phase times), which is
+     // lost if the nodal value is returned on its own.
+     adouble dp_hit = 0.0, d2p_hit = 0.0;
+
+     if (hit >= 0) {
+         double dii = 0.0;
+         for (j=0; j<n; j++) {
+              if (j != hit) dii -= (c.weights[j]/c.weights[hit])/(c.snodes[hit]-c.snodes[j]);
+         }
+         for (j=0; j<n; j++) {
+              if (j != hit) {
+                   double dij = (c.weights[j]/c.weights[hit])/(c.snodes[hit]-c.snodes[j]);
+                   dp_hit  += dij*(c.y[j]-c.y[hit]);
+                   d2p_hit += 2.0*dij*( dii - 1.0/(c.snodes[hit]-c.snodes[j]) )*(c.y[j]-c.y[hit]);
+              }
+         }
+     }
+
+     if (hit >= 0 && sv == c.snodes[hit]) {
+         if (value) *value = c.y[hit] + dp_hit*(s-c.snodes[hit]);
+     }
+     else if (value) {
+         adouble num = 0.0, den = 0.0, a;
+         for (j=0; j<n; j++) {
+              a    = c.weights[j]/(s-c.snodes[j]);
+              num += a*c.y[j];
+              den += a;
+         }
+         *value = num/den;
+     }
 
- if (  use_global_collocation(algorithm) && norder<100 ) {
- 	lagrange_interpolation_ad( interp_state, time, time_array, single_state_traj, norder+1, workspace);
+     if (derivative) {
+         adouble dp = 0.0;
+         if (hit >= 0) {
+             dp = dp_hit + d2p_hit*(s-c.snodes[hit]);
+         }
+         else {
+             adouble num = 0.0, den = 0.0, p = 0.0, a;
+             for (j=0; j<n; j++) {
+                  a    = c.weights[j]/(s-c.snodes[j]);
+                  num += a*c.y[j];
+                  den += a;
+             }
+             p = num/den;
+             for (j=0; j<n; j++) {
+                  dp += c.weights[j]/(s-c.snodes[j])*(p-c.y[j])/(s-c.snodes[j]);
+             }
+             dp = dp/den;
+         }
+         *derivative = dp*2.0/(c.tf-c.t0);
+     }
  }
- else  {
-	spline_interpolation( interp_state, time, time_array, single_state_traj, norder+1, workspace);
+ else {
+     // Natural cubic spline. The interval is searched starting from the one found in the
+     // previous call, as consecutive queries are usually made at increasing times.
+     double tv = time.value();
+
+     k = MIN( c.hint, n-2 );
+
+     if ( !( tv >= c.time[k].value() && tv <= c.time[k+1].value() ) ) {
+         if ( k+2 < n && tv >= c.time[k+1].value() && tv <= c.time[k+2].value() ) {
+              k = k+1;
+         }
+         else {
+              int kleft = 0, kright = n-1, kmid;
+              while (kright-kleft > 1) {
+                   kmid = (kright+kleft)/2;
+                   if (c.time[kmid].value() > tv) kright=kmid;
+                   else kleft=kmid;
+              }
+              k = kleft;
+         }
+     }
+
+     c.hint = k;
+
+     adouble h = c.time[k+1]-c.time[k];
+     if (h == 0.0) error_message("Bad time data in trajectory interpolation");
+     adouble A = (c.time[k+1]-time)/h;
+     adouble B = (time-c.time[k])/h;
+
+     if (value) {
+         *value = A*c.y[k]+B*c.y[k+1]+( (A*A*A-A)*c.d2y[k]+(B*B*B-B)*c.d2y[k+1] )*(h*h)/6.0;
+     }
+
+     if (derivative) {
+         *derivative = (c.y[k+1]-c.y[k])/h - (3.0*A*A-1.0)/6.0*h*c.d2y[k] + (3.0*B*B-1.0)/6.0*h*c.d2y[k+1];
+     }
  }
 
 }
 
 
-void get_interpolated_control(adouble* interp_control, int control_index, int iphase, adouble& time, adouble* xad, Workspace* workspace)
+void get_delayed_control(adouble* delayed_control, int control_index, int iphase, adouble& time, double delay, adouble* xad, Workspace* workspace)
 {
 
- int k;
- int i = iphase-1;
- Prob& problem = *workspace->problem;
- int norder = problem.phase[i].current_number_of_intervals;
- adouble t0, tf;
- double ts;
-
- adouble* time_array = workspace->time_array_tmp;
- adouble* single_control_traj =  workspace->single_trajectory_tmp;
- get_individual_control_trajectory(single_control_traj, control_index, iphase, xad, workspace);
- get_times( &t0, &tf, xad, iphase, workspace);
- for (k=1; k<=norder+1; k++) {
-        ts = (workspace->snodes[i])(k);
-	time_array[k-1]  =  convert_to_original_time_ad( ts, t0, tf );
- }
+ adouble delayed_time;
+
+ InterpCache& c = get_trajectory_interpolant(control_index, true, iphase, xad, workspace);
 
- spline_interpolation( interp_control, time, time_array, single_control_traj, norder+1, workspace);
+ if ( time-delay>c.t0 ) // Careful because this if-then statement may not be differentiable
+        delayed_time= time-delay;
+ else
+          delayed_time=c.t0; // what is best to do here?
+
+ evaluate_interpolant(c, delayed_time, delayed_control, NULL);
 
 }
 
-void get_control_derivative(adouble* control_derivative, int control_index, int iphase, adouble& time, adouble* xad, Workspace* workspace)
+void get_delayed_state(adouble* delayed_state, int state_index, int iphase, adouble& time, double delay, adouble* xad, Workspace* workspace)
 {
-// This function computes an approximation to the time derivative of a specified control variable, based
-// on an interpolated finite difference.
-     adouble t0, tf;
-     adouble pcontrol;
-     adouble control;
-     adouble ptime;
 
-     get_times(&t0, &tf, xad, iphase, workspace);
+ adouble delayed_time;
 
-     double h = sqrt(DMatrix::GetEPS());
+ InterpCache& c = get_trajectory_interpolant(state_index, false, iphase, xad, workspace);
 
-     if ( time == tf ) {
-	 h = -h;
-     }
+ if ( time-delay>c.t0 )
+        delayed_time= time-delay;
+ else
+          delayed_time=c.t0; // nothing best to do here...
 
-     ptime = time + h;
+ evaluate_interpolant(c, delayed_time, delayed_state, NULL);
 
-     get_interpolated_control(&control, control_index, iphase, time, xad, workspace);
+}
 
-     get_interpolated_control(&pcontrol, control_index, iphase, ptime, xad, workspace);
+void get_interpolated_state(adouble* interp_state, int state_index, int iphase, adouble& time, adouble* xad, Workspace* workspace)
+{
+
+ InterpCache& c = get_trajectory_interpolant(state_index, false, iphase, xad, workspace);
 
-     *control_derivative = (pcontrol - control)/h;
+ evaluate_interpolant(c, time, interp_state, NULL);
 
 }
 
-void get_state_derivative(adouble* state_derivative, int state_index, int iphase, adouble& time, adouble* xad, Workspace* workspace)
+
+void get_interpolated_control(adouble* interp_control, int control_index, int iphase, adouble& time, adouble* xad, Workspace* workspace)
 {
-// This function computes an approximation to the time derivative of a specified control variable, based
-// on an interpolated finite difference.
-     adouble t0, tf;
-     adouble pstate;
-     adouble state;
-     adouble ptime;
 
-     get_times(&t0, &tf, xad, iphase, workspace);
+ InterpCache& c = get_trajectory_interpolant(control_index, true, iphase, xad, workspace);
 
-     double h = sqrt(DMatrix::GetEPS());
+ evaluate_interpolant(c, time, interp_control, NULL);
 
-     if ( time == tf ) {
-	 h = -h;
-     }
+}
+
+void get_control_derivative(adouble* control_derivative, int control_index, int iphase, adouble& time, adouble* xad, Workspace* workspace)
+{
+// This function computes the time derivative of a specified control variable by
+// differentiating its spline interpolant.
 
-     ptime = time + h;
+ InterpCache& c = get_trajectory_interpolant(control_index, true, iphase, xad, workspace);
 
-     get_interpolated_state(&state, state_index, iphase, time, xad, workspace);
+ evaluate_interpolant(c, time, NULL, control_derivative);
+
+}
+
+void get_state_derivative(adouble* state_derivative, int state_index, int iphase, adouble& time, adouble* xad, Workspace* workspace)
+{
+// This function computes the time derivative of a specified state variable by
+// differentiating its interpolant.
 
-     get_interpolated_state(&pstate, state_index, iphase, ptime, xad, workspace);
+ InterpCache& c = get_trajectory_interpolant(state_index, false, iphase, xad, workspace);
 
-     *state_derivative = (pstate - state)/h;
+ evaluate_interpolant(c, time, NULL, state_derivative);
 
 }
 
@@ -30,6 +30,15 @@ e-mail:    v.m.becerra@ieee.org
 
 #include "psopt.h"
 
+#include <chrono>
+
+#ifdef WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
 
 adouble dot(adouble* x, adouble* y, int n)
 {
@@ -106,6 +115,36 @@ double chronometer_toc(Workspace* workspace)
 
 }
 
+double get_wall_clock_time()
+{
+// Returns the wall clock time in seconds from an arbitrary origin. Unlike clock(),
+// this is not affected by the number of threads in use, so it is used for deadlines.
+
+   std::chrono::duration<double> t = std::chrono::steady_clock::now().time_since_epoch();
+
+   return ( t.count() );
+}
+
+double percentile(DMatrix& x, double p)
+{
+// Returns the p-th percentile (0 <= p <= 100) of the elements of x using the nearest rank method.
+
+   int n = (int) length(x);
+   int k;
+
+   if (n==0) return 0.0;
+
+   DMatrix xs = x;
+
+   sort(xs);
+
+   k = (int) ceil( (p/100.0)*n );
+
+   k = MAX( 1, MIN( k, n ) );
+
+   return ( xs(k) );
+}
+
 
 void get_local_time( string& date_and_time)
 {
@@ -771,6 +810,57 @@ double convert_to_original_time(double tbar,double t0,double tf)
     return (  (tf+t0)/2.0 + (tf-t0)*tbar/2.0 );
 }
 
+string get_output_file_name(Alg& algorithm, const string& filename)
+{
+    // Path of an output file, placed in algorithm.output_directory if one is given so that
+    // solves running at the same time can keep their files apart.
+
+    const string& dir = algorithm.output_directory;
+
+    if ( dir == "" ) return filename;
+
+    char last = dir[ dir.size()-1 ];
+
+    if ( last == '/' || last == '\\' ) return dir + filename;
+
+    return dir + "/" + filename;
+}
+
+string make_output_subdirectory(Alg& algorithm, const string& name)
+{
+    // Creates, if needed, a subdirectory of the output directory and returns its path, so that
+    // solves run from one call, for example the starts of a multi-start solve, keep their files apart.
+
+    string dir = get_output_file_name(algorithm, name);
+
+#ifdef WIN32
+    _mkdir( dir.c_str() );
+#else
+    mkdir( dir.c_str(), 0755 );
+#endif
+
+    return dir;
+}
+
+bool nlp_solve_converged(Sol& solution, Alg& algorithm)
+{
+    // True if the last NLP solve ended successfully
+
+    if (solution.error_flag) return false;
+
+#ifdef USE_IPOPT
+    if (algorithm.nlp_method == "IPOPT") {
+        return ( solution.nlp_return_code == (int) Solve_Succeeded || solution.nlp_return_code == (int) Solved_To_Acceptable_Level );
+    }
+#endif
+
+    if (algorithm.nlp_method == "SNOPT") {
+        return ( solution.nlp_return_code == 0 );
+    }
+
+    return false;
+}
+
 adouble convert_to_original_time_ad(double tbar,adouble& t0,adouble& tf)
 {
 
@@ -47,8 +47,16 @@ void validate_user_input(Prob& problem, Alg& algorithm, Workspace* workspace)
        error_message("Incorrect differential defect scaling option specified. Valid options are \"state-based\" and \"jacobian-based\" ");
     if (algorithm.derivatives != "automatic" && algorithm.derivatives!="numerical")
        error_message("Incorrect derivatives option specified. Valid options are \"automatic\" and \"numerical\" ");
-    if (algorithm.hessian != "exact" && algorithm.hessian!="limited-memory")
-       error_message("Incorrect algorithm.hessian option specified. Valid options are \"limited-memory\" and \"exact\" ");
+    if (algorithm.hessian != "exact" && algorithm.hessian!="limited-memory" && algorithm.hessian!="gauss-newton")
+       error_message("Incorrect algorithm.hessian option specified. Valid options are \"limited-memory\", \"exact\" and \"gauss-newton\" ");
+    if (algorithm.hessian == "gauss-newton" && problem.observation_function == NULL)
+       error_message("The 'gauss-newton' algorithm.hessian option is only available for parameter estimation problems");
+    if (algorithm.hessian == "gauss-newton" && algorithm.derivatives != "automatic")
+       error_message("The 'gauss-newton' algorithm.hessian option requires automatic derivatives");
+    if (algorithm.hessian == "gauss-newton" && algorithm.parameter_estimation_norm != 2)
+       error_message("The 'gauss-newton' algorithm.hessian option requires algorithm.parameter_estimation_norm = 2");
+    if (algorithm.hessian == "gauss-newton" && algorithm.nlp_method != "IPOPT")
+       error_message("The 'gauss-newton' algorithm.hessian option is only available with the IPOPT solver");
     if (algorithm.hessian == "exact" && algorithm.nlp_method !="IPOPT") {
        sprintf(workspace->text,"\n*** Warning: the 'exact' algorithm.hessian option is only available with the IPOPT solver");
        psopt_print(workspace,workspace->text);
@@ -65,6 +73,16 @@ void validate_user_input(Prob& problem, Alg& algorithm, Workspace* workspace)
        error_message("algorithm.nlp_tolerance must be positive");
     if (algorithm.nlp_iter_max <= 0)
        error_message("algorithm.iter_max must be positive");
+    if (algorithm.realtime_mode != "yes" && algorithm.realtime_mode != "no")
+       error_message("Incorrect algorithm.realtime_mode option specified. Valid options are \"yes\" and \"no\" ");
+    if (algorithm.realtime_mode == "yes" && algorithm.realtime_iter_max <= 0)
+       error_message("algorithm.realtime_iter_max must be positive");
+    if (algorithm.realtime_mode == "yes" && algorithm.realtime_deadline <= 0)
+       error_message("algorithm.realtime_deadline must be positive");
+    if (algorithm.realtime_mode == "yes" && algorithm.nlp_method != "IPOPT") {
+       sprintf(workspace->text,"\n*** Warning: algorithm.realtime_mode is only available with the IPOPT solver");
+       psopt_print(workspace,workspace->text);
+    }
 
     if (algorithm.nsteps_error_integration <= 0)
        error_message("algorithm.nsteps_error_integration must be positive");
@@ -30,6 +30,79 @@ e-mail:    v.m.becerra@ieee.org
 
 #include "psopt.h"
 
+#include <climits>
+#include <mutex>
+#include <vector>
+
+
+static adouble* allocate_adoubles(int n, Workspace* workspace)
+{
+  // Every adouble registers with the ADOL-C location manager, so empty
+  // buffers are not allocated at all.
+
+  if (n <= 0) return NULL;
+
+  workspace->footprint += n*sizeof(adouble);
+
+  return new adouble[n];
+}
+
+// ADOL-C tape tags are handed out in blocks of TAPE_TAGS_PER_WORKSPACE, one block per live
+// workspace. A block is returned when its workspace is destroyed and given to the next
+// workspace, which keeps the tags within the range of ADOL-C's short tape identifiers and
+// lets new tapes reuse the memory ADOL-C holds for the old ones.
+
+#define TAPE_TAGS_PER_WORKSPACE 6
+
+static std::mutex        tape_tag_mutex;
+static std::vector<bool> tape_tag_block_in_use;
+
+static int acquire_tape_tag_block()
+{
+  std::lock_guard<std::mutex> lock(tape_tag_mutex);
+
+  int k, nblocks = (int) tape_tag_block_in_use.size();
+
+  for (k=0; k<nblocks; k++) {
+      if (!tape_tag_block_in_use[k]) break;
+  }
+
+  if ( (k+1)*TAPE_TAGS_PER_WORKSPACE > SHRT_MAX ) {
+      error_message("No ADOL-C tape tags left for a new workspace");
+  }
+
+  if (k == nblocks) tape_tag_block_in_use.push_back(true);
+  else              tape_tag_block_in_use[k] = true;
+
+  return k;
+}
+
+static void release_tape_tag_block(int k)
+{
+  std::lock_guard<std::mutex> lock(tape_tag_mutex);
+
+  if ( k>=0 && k < (int) tape_tag_block_in_use.size() ) tape_tag_block_in_use[k] = false;
+}
+
+template<class T> static void grow_array(T** a, int size, int new_size)
+{
+  // Reallocates array *a with new_size elements, keeping the first size elements
+
+  T* b = new T[new_size];
+
+  if (*a) {
+      memcpy(b, *a, size*sizeof(T));
+      delete [] *a;
+  }
+
+  *a = b;
+}
+
+static long matrix_bytes(const DMatrix& A)
+{
+  return A.GetNoRows()*A.GetNoCols()*sizeof(double);
+}
+
 
 void initialize_workspace_vars(Prob& problem, Alg& algorithm, Sol& solution, Workspace* workspace)
 {
@@ -42,6 +115,17 @@ void initialize_workspace_vars(Prob& problem, Alg& algorithm, Sol& solution, Wor
 
   int max_nodes = get_max_nodes_in_all_phases(problem, algorithm);
 
+  // Features which determine the buffers that need to be allocated
+
+  bool global_collocation = use_global_collocation(algorithm);
+
+  bool local_collocation  = use_local_collocation(algorithm);
+
+  bool hermite_simpson    = local_collocation && ( algorithm.collocation_method == "Hermite-Simpson" ||
+                            ( algorithm.mesh_refinement == "automatic" && algorithm.switch_order > 0 ) );
+
+  workspace->footprint = 0;
+
   workspace->P         = new DMatrix[nphases];
   workspace->sindex    = new DMatrix[nphases];
   workspace->w         = new DMatrix[nphases];
@@ -52,6 +136,8 @@ void initialize_workspace_vars(Prob& problem, Alg& algorithm, Sol& solution, Wor
   workspace->xub       = new DMatrix;
   workspace->x0        = new DMatrix;
   workspace->lambda    = new DMatrix;
+  workspace->zl        = new DMatrix;
+  workspace->zu        = new DMatrix;
   workspace->dual_costates = new DMatrix[nphases];
   workspace->dual_events   = new DMatrix[nphases];
   workspace->dual_path     = new DMatrix[nphases];
@@ -100,54 +186,42 @@ void initialize_workspace_vars(Prob& problem, Alg& algorithm, Sol& solution, Wor
 
 
 
-  if (algorithm.nlp_method=="IPOPT") {
-	workspace->iArow     = new int[(int) (algorithm.jac_sparsity_ratio*max_nvars*max_ncons)];
-	workspace->jAcol     = new int[(int) (algorithm.jac_sparsity_ratio*max_nvars*max_ncons)];
-	workspace->iGrow     = new int[(int) (algorithm.jac_sparsity_ratio*max_nvars*max_ncons)];
-	workspace->jGcol     = new int[(int) (algorithm.jac_sparsity_ratio*max_nvars*max_ncons)];
-	workspace->jac_Aij   = new double[(int) (algorithm.jac_sparsity_ratio*max_nvars*max_ncons)];
-	workspace->jac_Gij   = new double[(int) (algorithm.jac_sparsity_ratio*max_nvars*max_ncons)];
-	if (algorithm.hessian == "exact" ) {
-		workspace->hess_ir   = new unsigned int[(int) (algorithm.hess_sparsity_ratio*max_nvars*max_nvars)];
-		workspace->hess_jc   = new unsigned int[(int) (algorithm.hess_sparsity_ratio*max_nvars*max_nvars)];
-		workspace->lambda_d  = new double [max_ncons];
-	}
-  }
-  else {
-    workspace->iArow     = NULL;
-	workspace->jAcol     = NULL;
-	workspace->iGrow     = NULL;
-	workspace->jGcol     = NULL;
-	workspace->jac_Aij   = NULL;
-	workspace->jac_Gij   = NULL;
-    workspace->hess_ir   = NULL;
-    workspace->hess_jc   = NULL;
-    workspace->lambda_d  = NULL;
-  }
-  
-  if ( algorithm.nlp_method == "SNOPT") {
-  	workspace->iGfun     = new unsigned int[(int) (algorithm.jac_sparsity_ratio*max_nvars*(max_ncons+1))];
-  	workspace->jGvar     = new unsigned int[(int) (algorithm.jac_sparsity_ratio*max_nvars*(max_ncons+1))];
-  	workspace->iGfun1    = new unsigned int[(int) (algorithm.jac_sparsity_ratio*max_nvars*(max_ncons+1))];
-  	workspace->jGvar1    = new unsigned int[(int) (algorithm.jac_sparsity_ratio*max_nvars*(max_ncons+1))];
-  	workspace->iGfun2    = new unsigned int[(int) (algorithm.jac_sparsity_ratio*max_nvars*(max_ncons+1))];
-  	workspace->jGvar2    = new unsigned int[(int) (algorithm.jac_sparsity_ratio*max_nvars*(max_ncons+1))];
-  	workspace->G2        = new double[(int) (algorithm.jac_sparsity_ratio*max_nvars*(max_ncons+1))];
-  }
-  else {
-  	workspace->iGfun     = NULL;
-  	workspace->jGvar     = NULL;
-  	workspace->iGfun1    = NULL;
-  	workspace->jGvar1    = NULL;
-  	workspace->iGfun2    = NULL;
-  	workspace->jGvar2    = NULL;
-  	workspace->G2        = NULL;
+  workspace->iArow     = NULL;
+  workspace->jAcol     = NULL;
+  workspace->iGrow     = NULL;
+  workspace->jGcol     = NULL;
+  workspace->jac_Aij   = NULL;
+  workspace->jac_Gij   = NULL;
+  workspace->hess_ir   = NULL;
+  workspace->hess_jc   = NULL;
+  workspace->hess_colptr = NULL;
+  workspace->lambda_d  = NULL;
+
+  workspace->iGfun     = NULL;
+  workspace->jGvar     = NULL;
+  workspace->G_map     = NULL;
+  workspace->iGfun2    = NULL;
+  workspace->jGvar2    = NULL;
+  workspace->G2        = NULL;
+
+  // The sparse index and value arrays are sized when the sparsity pattern
+  // is detected, see reserve_jacobian_storage() and reserve_hessian_storage()
+
+  workspace->jac_capacity   = 0;
+  workspace->hess_capacity  = 0;
+  workspace->snopt_capacity = 0;
+
+  if (algorithm.nlp_method=="IPOPT" && algorithm.hessian != "limited-memory" ) {
+	workspace->lambda_d  = new double [max_ncons];
+	workspace->footprint += max_ncons*sizeof(double);
   }
-  workspace->xad       = new adouble[max_nvars];
-  workspace->gad       = new adouble[max_ncons];
-  workspace->fgad      = new adouble[max_ncons+1];
+
+  workspace->xad       = allocate_adoubles(max_nvars, workspace);
+  workspace->gad       = allocate_adoubles(max_ncons, workspace);
+  workspace->fgad      = allocate_adoubles(max_ncons+1, workspace);
   workspace->fg        = new double[max_ncons+1];
   workspace->nrm_row   = new double[max_ncons+1];
+  workspace->footprint += 2*(max_ncons+1)*sizeof(double);
 
   workspace->states    = new adouble*[nphases];
   workspace->controls  = new adouble*[nphases];
@@ -162,7 +236,7 @@ void initialize_workspace_vars(Prob& problem, Alg& algorithm, Sol& solution, Wor
   workspace->path            = new adouble*[nphases];
   workspace->states_traj     = new adouble*[nphases];
   workspace->derivs_traj     = new adouble*[nphases];
-  workspace->linkages        = new adouble[problem.nlinkages];
+  workspace->linkages        = allocate_adoubles(problem.nlinkages, workspace);
   workspace->states_next     = new adouble*[nphases];
   workspace->controls_next   = new adouble*[nphases];
   workspace->derivatives_next   = new adouble*[nphases];
@@ -181,12 +255,46 @@ void initialize_workspace_vars(Prob& problem, Alg& algorithm, Sol& solution, Wor
 
   workspace->trace_f_done    = false;
 
-  workspace->time_array_tmp = new adouble[max_nodes +1];
-  workspace->single_trajectory_tmp = new adouble[max_nodes +1];
-  workspace->L_ad_tmp = new adouble[max_nodes +1];
-  workspace->u_spline   = new adouble[max_nodes +1];
-  workspace->z_spline   = new adouble[max_nodes +1];
-  workspace->y2a_spline = new adouble[max_nodes +1];
+  workspace->trace_res_done  = false;
+
+  workspace->nlp_structure_done = false;
+
+  workspace->fixed_size_active  = false;
+
+  workspace->interp_cache        = new InterpCache*[nphases];
+  workspace->interp_epoch        = 0;
+  workspace->interp_cache_active = false;
+
+  for(i=0; i<nphases; i++) workspace->interp_cache[i] = NULL;
+
+  workspace->obs_weights         = new ObsWeights[nphases];
+
+  workspace->jac_nnz       = 0;
+  workspace->hess_nnz      = 0;
+  workspace->jac_rind      = NULL;
+  workspace->jac_cind      = NULL;
+  workspace->jac_ad_values = NULL;
+
+  workspace->res_jac_rind   = NULL;
+  workspace->res_jac_cind   = NULL;
+  workspace->res_jac_values = NULL;
+  workspace->res_jac_nnz    = 0;
+
+  workspace->cancel_flag               = NULL;
+
+  workspace->realtime_flag             = false;
+  workspace->realtime_deadline_reached = false;
+  workspace->realtime_best_found       = false;
+  workspace->realtime_niter            = 0;
+  workspace->realtime_best_x           = new DMatrix;
+  workspace->realtime_iteration_times  = new DMatrix;
+
+  workspace->time_array_tmp = allocate_adoubles(max_nodes +1, workspace);
+  workspace->single_trajectory_tmp = allocate_adoubles(max_nodes +1, workspace);
+  workspace->L_ad_tmp = allocate_adoubles(max_nodes +1, workspace);
+  workspace->u_spline   = allocate_adoubles(max_nodes +1, workspace);
+  workspace->z_spline   = allocate_adoubles(max_nodes +1, workspace);
+  workspace->y2a_spline = allocate_adoubles(max_nodes +1, workspace);
 
 
  for(i=0; i< problem.nphases; i++)
@@ -210,37 +318,54 @@ void initialize_workspace_vars(Prob& problem, Alg& algorithm, Sol& solution, Wor
           workspace->prev_param[i].Resize(nparam,1);
         }
 
-        workspace->states[i]= new adouble[nstates];
-        workspace->controls[i] = new adouble[ncontrols];
-        workspace->parameters[i] = new adouble[nparam];
-        workspace->resid[i]= new adouble[nstates];
-        workspace->derivatives[i]= new adouble[nstates];
-        workspace->initial_states[i]= new adouble[nstates];
-        workspace->final_states[i]= new adouble[nstates];
-        workspace->initial_controls[i]= new adouble[ncontrols];
-        workspace->final_controls[i]= new adouble[ncontrols];
-        workspace->events[i]= new adouble[nevents];
-        workspace->path[i]= new adouble[npath];
+        workspace->states[i]= allocate_adoubles(nstates, workspace);
+        workspace->controls[i] = allocate_adoubles(ncontrols, workspace);
+        workspace->parameters[i] = allocate_adoubles(nparam, workspace);
+        workspace->resid[i]= allocate_adoubles(nstates, workspace);
+        workspace->derivatives[i]= allocate_adoubles(nstates, workspace);
+        workspace->initial_states[i]= allocate_adoubles(nstates, workspace);
+        workspace->final_states[i]= allocate_adoubles(nstates, workspace);
+        workspace->initial_controls[i]= allocate_adoubles(ncontrols, workspace);
+        workspace->final_controls[i]= allocate_adoubles(ncontrols, workspace);
+        workspace->events[i]= allocate_adoubles(nevents, workspace);
+        workspace->path[i]= allocate_adoubles(npath, workspace);
+
+        // Buffers for the next node, used by trapezoidal and Hermite-Simpson defects
+
+        int nnext = local_collocation ? 1 : 0;
+
+        workspace->states_next[i]     = allocate_adoubles(nnext*nstates, workspace);
+        workspace->controls_next[i]   = allocate_adoubles(nnext*ncontrols, workspace);
+        workspace->derivatives_next[i]= allocate_adoubles(nnext*nstates, workspace);
+        workspace->path_next[i]       = allocate_adoubles(nnext*npath, workspace);
+
+        // Midpoint buffers, only used by Hermite-Simpson defects
 
-        workspace->states_next[i]     = new adouble[nstates];
-        workspace->controls_next[i]   = new adouble[ncontrols];
-        workspace->derivatives_next[i]= new adouble[nstates];
-        workspace->path_next[i]       = new adouble[npath];
-        workspace->states_bar[i]      = new adouble[nstates];
-        workspace->controls_bar[i]    = new adouble[ncontrols];
-        workspace->derivatives_bar[i] = new adouble[nstates];
+        int nbar = hermite_simpson ? 1 : 0;
 
-        workspace->path_bar[i]        = new adouble[npath];
+        workspace->states_bar[i]      = allocate_adoubles(nbar*nstates, workspace);
+        workspace->controls_bar[i]    = allocate_adoubles(nbar*ncontrols, workspace);
+        workspace->derivatives_bar[i] = allocate_adoubles(nbar*nstates, workspace);
 
-   	workspace->observed_variable[i] = new adouble[nobserved];
-	workspace->observed_residual[i] = new adouble[nobserved];
-  	workspace->lam_resid[i]              = new adouble[nobserved];
+        workspace->path_bar[i]        = allocate_adoubles(nbar*npath, workspace);
 
-   	workspace->interp_states_pe[i]   = new adouble[nstates];
-	workspace->interp_controls_pe[i] = new adouble[ncontrols];
+        // Observation buffers, only used in parameter estimation problems
 
-        workspace->states_traj[i]= new adouble[problem.phase[i].nstates*(max_nodes +1)];
-        workspace->derivs_traj[i]= new adouble[problem.phase[i].nstates*(max_nodes +1)];
+        int npe = (nobserved>0) ? 1 : 0;
+
+   	workspace->observed_variable[i] = allocate_adoubles(nobserved, workspace);
+	workspace->observed_residual[i] = allocate_adoubles(nobserved, workspace);
+  	workspace->lam_resid[i]              = allocate_adoubles(nobserved, workspace);
+
+   	workspace->interp_states_pe[i]   = allocate_adoubles(npe*nstates, workspace);
+	workspace->interp_controls_pe[i] = allocate_adoubles(npe*ncontrols, workspace);
+
+        // State and derivative trajectories, only used by differentiation matrix defects
+
+        int ntraj = global_collocation ? nstates*(max_nodes+1) : 0;
+
+        workspace->states_traj[i]= allocate_adoubles(ntraj, workspace);
+        workspace->derivs_traj[i]= allocate_adoubles(ntraj, workspace);
 
 
   }
@@ -249,13 +374,15 @@ void initialize_workspace_vars(Prob& problem, Alg& algorithm, Sol& solution, Wor
 
   workspace->igroup = new IGroup;
 
-  string fname = "psopt_solution_" + problem.outfilename.substr(0,dotindex) + ".txt";
+  string fname = get_output_file_name(algorithm, "psopt_solution_" + problem.outfilename.substr(0,dotindex) + ".txt");
 
   workspace->psopt_solution_summary_file = fopen(fname.c_str(),"w");
 
-  workspace->mesh_statistics = fopen("mesh_statistics.txt","w");
+  fname = get_output_file_name(algorithm, "mesh_statistics.txt");
+
+  workspace->mesh_statistics = fopen(fname.c_str(),"w");
 
-  fname = "mesh_statistics_" + problem.outfilename.substr(0,dotindex) + ".tex";
+  fname = get_output_file_name(algorithm, "mesh_statistics_" + problem.outfilename.substr(0,dotindex) + ".tex");
 
   workspace->mesh_statistics_tex = fopen( fname.c_str(),"w");
 
@@ -273,13 +400,19 @@ void initialize_workspace_vars(Prob& problem, Alg& algorithm, Sol& solution, Wor
 
   workspace->auto_linked_flag = false;
 
-// Initialise tape tags to be used by ADOL_C
+// Initialise tape tags to be used by ADOL_C. Each workspace has its own block of tags,
+// so that solves running in different threads do not overwrite each other's tapes.
+
+  workspace->tape_tag_block = acquire_tape_tag_block();
 
-  workspace->tag_f        = 1;
-  workspace->tag_g 	     = 2;
-  workspace->tag_hess     = 3;
-  workspace->tag_fg 	     = 4;
-  workspace->tag_gc       = 5;
+  int tag0 = workspace->tape_tag_block*TAPE_TAGS_PER_WORKSPACE;
+
+  workspace->tag_f        = tag0+1;
+  workspace->tag_g 	     = tag0+2;
+  workspace->tag_hess     = tag0+3;
+  workspace->tag_fg 	     = tag0+4;
+  workspace->tag_gc       = tag0+5;
+  workspace->tag_res      = tag0+6;
 
   workspace->user_data = problem.user_data;
 
@@ -357,8 +490,99 @@ void resize_workspace_vars(Prob& problem, Alg& algorithm, Sol& solution, Workspa
 
 
 
+void reserve_jacobian_storage(int nnz, Workspace* workspace)
+{
+  // Makes room for at least nnz elements in the Jacobian triplet arrays used with
+  // IPOPT, keeping their contents. The capacity grows geometrically, so the storage
+  // follows the number of non-zeros detected for the largest mesh.
+
+  int size = workspace->jac_capacity;
+
+  if (nnz <= size) return;
+
+  int new_size = MAX( nnz, size + size/2 );
+
+  grow_array( &workspace->iArow,   size, new_size );
+  grow_array( &workspace->jAcol,   size, new_size );
+  grow_array( &workspace->iGrow,   size, new_size );
+  grow_array( &workspace->jGcol,   size, new_size );
+  grow_array( &workspace->jac_Aij, size, new_size );
+  grow_array( &workspace->jac_Gij, size, new_size );
+
+  workspace->footprint   += ((long) (new_size-size))*( 4*sizeof(int) + 2*sizeof(double) );
+  workspace->jac_capacity = new_size;
+}
+
+void reserve_hessian_storage(int nnz, Workspace* workspace)
+{
+  // As reserve_jacobian_storage(), for the Hessian index arrays
+
+  int size = workspace->hess_capacity;
+
+  if (nnz <= size) return;
+
+  int new_size = MAX( nnz, size + size/2 );
+
+  grow_array( &workspace->hess_ir, size, new_size );
+  grow_array( &workspace->hess_jc, size, new_size );
+
+  workspace->footprint    += ((long) (new_size-size))*2*sizeof(unsigned int);
+  workspace->hess_capacity = new_size;
+}
+
+void reserve_snopt_jacobian_storage(int nnz, Workspace* workspace)
+{
+  // As reserve_jacobian_storage(), for the Jacobian index arrays used with SNOPT
+
+  int size = workspace->snopt_capacity;
+
+  if (nnz <= size) return;
+
+  int new_size = MAX( nnz, size + size/2 );
+
+  grow_array( &workspace->iGfun,  size, new_size );
+  grow_array( &workspace->jGvar,  size, new_size );
+  grow_array( &workspace->G_map,  size, new_size );
+
+  workspace->footprint     += ((long) (new_size-size))*( 2*sizeof(unsigned int) + sizeof(int) );
+  workspace->snopt_capacity = new_size;
+}
+
+long get_workspace_footprint(Prob& problem, Workspace* workspace)
+{
+  // Returns the approximate number of bytes held by the workspace: the buffers
+  // allocated by initialize_workspace_vars() plus the matrices sized for the
+  // current NLP.
+
+  int i;
+
+  long bytes = workspace->footprint;
+
+  DMatrix* nlp_matrices[] = { workspace->x0, workspace->xlb, workspace->xub, workspace->lambda, workspace->zl,
+                              workspace->zu, workspace->constraint_scaling, workspace->Xsnopt, workspace->gsnopt,
+                              workspace->Xip, workspace->JacRow, workspace->Gip, workspace->GFip, workspace->JacCol1,
+                              workspace->JacCol2, workspace->JacCol3, workspace->xp, workspace->grw->dfdx_j,
+                              workspace->grw->F1, workspace->grw->F2, workspace->grw->F3, workspace->grw->F4 };
+
+  for(i=0; i< (int) (sizeof(nlp_matrices)/sizeof(DMatrix*)); i++) {
+        bytes += matrix_bytes( *nlp_matrices[i] );
+  }
+
+  for(i=0; i< problem.nphases; i++) {
+        bytes += matrix_bytes( workspace->P[i] ) + matrix_bytes( workspace->D[i] ) + matrix_bytes( workspace->w[i] );
+        bytes += matrix_bytes( workspace->snodes[i] ) + matrix_bytes( workspace->dual_costates[i] );
+        bytes += matrix_bytes( workspace->dual_path[i] ) + matrix_bytes( workspace->DerivResid[i] );
+        bytes += matrix_bytes( workspace->Xdot[i] ) + matrix_bytes( workspace->Xdotgg[i] ) + matrix_bytes( workspace->hgg[i] );
+  }
+
+  return bytes;
+}
+
+
 work_str::~work_str()
 {
+  if (this->tape_tag_block != -1) release_tape_tag_block(this->tape_tag_block);
+
   for(long unsigned int i=0; i< this->nphases; i++)
   {
     delete [] this->states[i];
@@ -392,25 +616,35 @@ work_str::~work_str()
 
     delete [] this->states_traj[i];
     delete [] this->derivs_traj[i];
+
+    if (this->interp_cache[i]) delete [] this->interp_cache[i];
   }
 
-  if (this->G2) delete [] this->G2;
   if (this->hess_ir) delete [] this->hess_ir;
   if (this->hess_jc) delete [] this->hess_jc;
+  if (this->hess_colptr) delete [] this->hess_colptr;
   if (this->iArow) delete [] this->iArow;
-  if (this->iGfun1) delete [] this->iGfun1;
-  if (this->iGfun2) delete [] this->iGfun2;
+  if (this->G_map) delete [] this->G_map;
   if (this->iGfun) delete [] this->iGfun;
   if (this->iGrow) delete [] this->iGrow;
   if (this->jac_Aij) delete [] this->jac_Aij;
   if (this->jac_Gij) delete [] this->jac_Gij;
   if (this->jAcol) delete [] this->jAcol;
   if (this->jGcol) delete [] this->jGcol;
-  if (this->jGvar1) delete [] this->jGvar1;
-  if (this->jGvar2) delete [] this->jGvar2;
   if (this->jGvar) delete [] this->jGvar;
   if (this->lambda_d) delete [] this->lambda_d;
 
+  // The arrays below are allocated by ADOL-C's sparse_jac() using malloc()
+  if (this->jac_rind) free(this->jac_rind);
+  if (this->jac_cind) free(this->jac_cind);
+  if (this->jac_ad_values) free(this->jac_ad_values);
+  if (this->res_jac_rind) free(this->res_jac_rind);
+  if (this->res_jac_cind) free(this->res_jac_cind);
+  if (this->res_jac_values) free(this->res_jac_values);
+  if (this->iGfun2) free(this->iGfun2);
+  if (this->jGvar2) free(this->jGvar2);
+  if (this->G2) free(this->G2);
+
   delete [] this->xad;
   delete [] this->gad;
   delete [] this->fgad;
@@ -444,6 +678,8 @@ work_str::~work_str()
   delete [] this->interp_states_pe;
   delete [] this->interp_controls_pe;
   delete [] this->lam_resid;
+  delete [] this->interp_cache;
+  delete [] this->obs_weights;
 
   delete [] this->time_array_tmp;
   delete [] this->single_trajectory_tmp;
@@ -464,6 +700,10 @@ work_str::~work_str()
   delete    this->xub;
   delete    this->x0;
   delete    this->lambda;
+  delete    this->zl;
+  delete    this->zu;
+  delete    this->realtime_best_x;
+  delete    this->realtime_iteration_times;
   delete [] this->dual_costates;
   delete [] this->dual_events;
   delete [] this->dual_path;
@@ -499,11 +739,13 @@ work_str::~work_str()
   delete [] this->old_relative_errors;
   delete [] this->error_scaling_weights;
 
-  delete this->grw->dfdx_j;
-  delete this->grw->F1;
-  delete this->grw->F2;
-  delete this->grw->F3;
-  delete this->grw->F4;
+  if (this->grw) {
+     delete this->grw->dfdx_j;
+     delete this->grw->F1;
+     delete this->grw->F2;
+     delete this->grw->F3;
+     delete this->grw->F4;
+  }
 
   delete this->grw;
 
@@ -63,12 +63,22 @@ Author:    Dr. Victor M. Becerra,  University of Reading, School of Systems Engi
 // typedef int bool;
 #endif
 
+// Initial number of temporary objects per thread, the table of temporary
+// objects grows on demand when an expression needs more of them
 #ifndef N_TEMP_OBJECTS
 #define N_TEMP_OBJECTS  (40)
 #endif
 
-#ifndef D_TEMP_OBJECTS
-#define D_TEMP_OBJECTS (1000000)
+// Move constructor and move assignment are declared when the compiler
+// supports rvalue references
+#if !defined(DMATRIX_MOVE_SEMANTICS) && ( __cplusplus >= 201103L || ( defined(_MSC_VER) && _MSC_VER >= 1600 ) )
+#define DMATRIX_MOVE_SEMANTICS
+#endif
+
+// Matrix products with at least this number of multiply-add operations are
+// computed with the BLAS routines dgemm and dgemv when LAPACK is defined
+#ifndef BLAS_PRODUCT_THRESHOLD
+#define BLAS_PRODUCT_THRESHOLD (1000)
 #endif
 
 #ifndef OUTPUT_STREAM
@@ -152,6 +162,9 @@ using std::string;
 
 class DMatrix;
 class SparseMatrix;
+template <class E> class DMatrixExpr;
+template <class L, class R, class Op> class DMatrixBinary;
+template <class E, class Op> class DMatrixScalar;
 
 //! DMatrix class
 
@@ -194,12 +207,10 @@ protected:
     const DMatrix* colIndx;
 
    // Protected static members
-//! Array of Temporary matrices
-   static DEC_THREAD DMatrix* auxPr;
+//! Table of pointers to temporary matrices
+   static DEC_THREAD DMatrix** auxPr;
 //! Number of auxiliary matrices
    static DEC_THREAD int      noAuxArr;
-//! Dimension of auxiliary arrays
-   static DEC_THREAD long      dimAux;
 //! Index of used auxiliary matrices
    static DEC_THREAD int      auxIndx;
 //! Member function flag to control resetting of auxIndx
@@ -223,6 +234,10 @@ protected:
    static DEC_THREAD clock_t start_clock;
 //! returns pointer to the i-th temporary object
    static DMatrix*  GetTempPr(int i);
+//! Enlarges the table of temporary objects to hold at least nn objects
+   static void   ExpandAuxArr(int nn);
+//! Takes over the storage of A instead of copying its elements
+   void   TakeStorage( DMatrix& A );
 //! Gets the memberFlag value from the object
    static int    GetMemberFlag() { return memberFlag; }
 //! Sets the memberFlag value
@@ -231,8 +246,6 @@ protected:
    static void   ChkAuxArrays();
 //! Gets the number of temporary objects
    static int    GetNoAuxArr() { return noAuxArr; }
-//! Gets the dimensions of the array of temporary objects
-   static long    GetDimAux() { return dimAux; }
 //! Gets the value of initFlag
    static int    GetInitFlag() { return initFlag; }
 //! Sets the value of initFlag
@@ -249,10 +262,6 @@ protected:
    static int    DecrementAuxIndx() { return --auxIndx ; }
 //! Sets the index of temporary objects
    static void   SetAuxIndx( int i ) {  auxIndx = i; }
-//! Sets the dimension of each object in the array of temporary objects
-   static void   SetDimAux( long dd ) { dimAux =  dd; }
-//! Sets the number of auxiliary objects
-   static void   SetNoAuxArr( int nn ) { noAuxArr = nn ; }
 //! Sets the errorFlag member to true
    static void   RiseErrorFlag()   { errorFlag = true; }
 //! Sets the value of auxFlag
@@ -264,13 +273,6 @@ protected:
 //! Sets the value of start_clock member
    static void SetStartTicks(clock_t st) { start_clock=st; }
 
-#ifdef DECLARED_TEMPS
-
-   static DEC_THREAD double axp[N_TEMP_OBJECTS][D_TEMP_OBJECTS];
-
-#endif
-
-
 #define MC_EPSILON 2.221e-16
 
   //! Cholesky decomposition of a matrix
@@ -377,12 +379,14 @@ public:
 #ifdef SPARSE_MATRIX
    friend class SparseMatrix;
 #endif
+   template <class E> friend class DMatrixExpr;
 
    // Public methods
   //! Allocates the array of auxiliary (temporary) objects used by the class
-  /** Allocates a DMatrix array of size N_TEMP_OBJECTS. Each element is allocated a storage of
-      size D_TEMP_OBJECTS. These two macros are given default values but may be changed by
-      the user at compilation time. The purpose of the array of temporary objects is to
+  /** Allocates a table of N_TEMP_OBJECTS temporary DMatrix objects. The table grows on demand
+      if an expression needs more temporaries, and the storage of each temporary is allocated
+      and enlarged by Resize() as the results it holds require, so the temporaries of a thread
+      only take the memory of its working set. The purpose of the array of temporary objects is
       to store the intermediate objects resulting from single lines of code that
       call various operators and functions returning DMatrix objects. A simple example is as
       follows. Consider the C++ statement
@@ -407,11 +411,11 @@ public:
       \return double Gaussian pseudo-random value
   */
    static double random_gaussian(void);
-  //! Gets a pointer to the array of auxiliary objects
+  //! Gets a pointer to the table of auxiliary objects
   /**
       \return DMatrix** pointer
   */
-   static DMatrix**  GetAuxPr(void)   { return &auxPr; }
+   static DMatrix**  GetAuxPr(void)   { return auxPr; }
   //! Checks if the error flag has been raised. If so, a 1 is returned, 0 otherwise
   /**
       \return int value
@@ -461,6 +465,18 @@ public:
       \return void
   */
    void Load( const char * FileName );
+  //! Makes the matrix use an external array as storage, without copying it
+  /**
+      Any storage previously allocated by the object is released. The array is not freed by the
+      object, so it must remain valid while the matrix uses it. Passing a NULL pointer detaches the
+      matrix from the external array and leaves it empty.
+      \param  vDim:  length of array v
+      \param  v:     double array to be used as storage by the DMatrix object, or NULL
+      \param  Initn: number of rows
+      \param  Initm: number of columns
+      \return void
+  */
+   void UseExternalArray( long vDim, double* v, long Initn, long Initm );
 
   //! Prints the elements of a matrix elements matrix to a file
   /**
@@ -724,6 +740,13 @@ public:
       \param A:     DMatrix object to be copied
   */
    DMatrix( const DMatrix& A); // copy constructor
+#ifdef DMATRIX_MOVE_SEMANTICS
+  //! Move constructor. Creates a new DMatrix object that takes over the storage of a given object, which is left empty. Only genuine rvalues (e.g. std::move(A)) are moved: functions such as tra() or Product() return references to temporary objects, which are copied.
+  /**
+      \param A:     DMatrix object to be moved
+  */
+   DMatrix( DMatrix&& A );
+#endif
 
 
   //! Destructor. Destroys a previously created DMatrix object and frees any allocated memory.
@@ -748,47 +771,42 @@ public:
   */
    void MemCpyArray(double * aptr );
 
-   // Operators
-  //! Matrix addition operator. The sizes of the matrices being added should be the same, otherwise an error is thrown.
+  //! Constructor from an elementwise expression of two matrices, such as A+B or A-B. The expression is evaluated in a single loop into the storage of the new object.
   /**
-      \param rval:  matrix located at the right hand side of the operator.
-      \return Reference to a temporary DMatrix object with the result of the operation
+      \param expr: expression object returned by an elementwise operator
   */
-   DMatrix& operator+ (const DMatrix& rval) const;
+   template <class L, class R, class Op> DMatrix( const DMatrixBinary<L,R,Op>& expr );
+  //! Constructor from an elementwise expression of a matrix and a scalar, such as 2.0*A. The expression is evaluated in a single loop into the storage of the new object.
+  /**
+      \param expr: expression object returned by an elementwise operator
+  */
+   template <class E, class Op> DMatrix( const DMatrixScalar<E,Op>& expr );
+
+   // Operators
   //! Matrix addition and substitution operator. The sizes of the matrices being added should be the same, otherwise an error is thrown.The left hand side object elements are replaced with the result of the operation.
   /**
       \param rval:  matrix located right hand side of the operator.
       \return Reference to the calling object
   */
    DMatrix& operator += (const DMatrix &rval);
-  //! Adds a scalar real value to each element of the matrix. .
+  //! Addition and substitution of an elementwise matrix expression, which is evaluated in the same loop as the addition.
   /**
-      \param x:  double value to be added
+      \param expr:  expression located right hand side of the operator.
+      \return Reference to the calling object
   */
-   DMatrix& operator+ (double x) const;
+   template <class E> DMatrix& operator += (const DMatrixExpr<E>& expr);
   //! Matrix subtraction and substitution operator. The sizes of the matrices being subtracted should be the same, otherwise an error is thrown.The left hand side object elements are replaced with the result of the operation.
   /**
       \param rval:  matrix located right hand side of the operator.
       \return Reference to the calling object
   */
    DMatrix& operator -= (const DMatrix &rval);
-  //! Matrix subtraction operator. The sizes of the matrices being subtracted should be the same, otherwise an error is thrown.
-  /**
-      \param rval:  matrix located at the right hand side of the operator.
-      \return Reference to a temporary DMatrix object with the result of the operation
-  */
-   DMatrix& operator- (const DMatrix& rval) const;
-  //! Subtracts a scalar real value from each element of the matrix. .
-  /**
-      \param x:  double value to be subtracted
-  */
-   DMatrix& operator- (double x) const;
-  //! Matrix unary minus operator. Returns an object of the same dimensions as A but with changed element signs.
+  //! Subtraction and substitution of an elementwise matrix expression, which is evaluated in the same loop as the subtraction.
   /**
-      \param A:  matrix located at the right hand side of the operator.
-      \return Reference to a temporary DMatrix object with the result of the operation
+      \param expr:  expression located right hand side of the operator.
+      \return Reference to the calling object
   */
-   friend DMatrix& operator- (const DMatrix& A);
+   template <class E> DMatrix& operator -= (const DMatrixExpr<E>& expr);
   //! Matrix product operator. Returns the result of the matrix product of the calling object (left hand side of the operator) and the right hand side object. The inner dimensions of the objects being multiplied should be consistent, otherwise an error will be thrown.
   /**
       \param rval:  matrix located at the right hand side of the operator.
@@ -801,24 +819,12 @@ public:
       \return Reference to the calling DMatrix object
   */
    DMatrix& operator *= (const DMatrix &rval);
-  //! Computes the product of a matrix (left hand side of the operator) times a real scalar (right hand side value) and replaces the left hand side object with the result of the operation.
-  /**
-      \param Arg: double value that will multiply each element of the matrix.
-      \return Reference the calling DMatrix object
-  */
-   DMatrix& operator* (double Arg) const;
   //! Computes the product of a matrix (left hand side of the operator) times a real scalar (right hand side value), and modifies the calling object to store the result of the operation.
   /**
       \param Arg: double value that will multiply each element of the matrix.
       \return Reference to the calling DMatrix object
   */
    DMatrix& operator *= (double Arg);
-  //! Computes the division of a matrix (left hand side of the operator) by a real scalar (right hand side value).
-  /**
-      \param Arg: double value that will divide each element of the matrix.
-      \return Reference to a temporary DMatrix object with the result of the operation
-  */
-   DMatrix& operator/ (double Arg) const;
   //! Computes the right division of a matrix (left hand side of the operator) by another matrix (right hand side value). This is conceptually equivalent to multiplying the left object by the inverse of the right hand side object but it is computed in a more efficient way. The dimensions of the matrices must be consistent, otherwise an error is returned. The right hand side object must be a square matrix.
   /**
       \param rval: DMatrix object at the right hand side of the operator.
@@ -843,6 +849,20 @@ public:
       \return Reference to the calling object
   */
    DMatrix& operator= (const DMatrix& rval);
+#ifdef DMATRIX_MOVE_SEMANTICS
+  //! Move assignment. The calling object takes over the storage of the right hand side object, which is left empty. If the calling object is a "colon reference" matrix or uses preallocated storage, the elements are copied instead.
+  /**
+      \param rval: DMatrix object at the right hand side of the operator
+      \return Reference to the calling object
+  */
+   DMatrix& operator= (DMatrix&& rval);
+#endif
+  //! Assignment of an elementwise matrix expression. The expression is evaluated in a single loop that writes directly into the calling object, without temporary objects for the intermediate results.
+  /**
+      \param expr: expression object returned by an elementwise operator
+      \return Reference to the calling object
+  */
+   template <class E> DMatrix& operator= (const DMatrixExpr<E>& expr);
   //! Matrix assignment to a scalar. The size of the left hand side object is modified to one row by one column if necessary, and the value of the right hand side argument is copied to the single element of the matrix. If the calling object is a "colon reference" matrix, then the right hand side value is copied to each element of the referenced array elements.
   /**
       \param val: double value at the right hand side of the operator
@@ -873,18 +893,6 @@ public:
       \return Reference to a temporary DMatrix object with the result of the operation
   */
    DMatrix& operator^(double x);
-  //! Elementwise product operator. Returns a DMatrix object with the same dimensions of the calling objects and each of its elements is computed as the product of the corresponding elements of the calling object and the right hand side object. The dimensions of the calling objects must be the same, otherwise an error is thrown. Care must be taken when using this operator as the associations do not work in the same way as with the * operator. It is highly recommended to use parenthesis every time this operator is used. For example use it as follows:   (A&B).
-  /**
-      \param B: DMatrix object at the right hand side of the operator
-      \return Reference to a temporary DMatrix object with the result of the operation
-  */
-   DMatrix& operator &(const DMatrix& B) const;
-  //! Elementwise division operator. Returns a DMatrix object with the same dimensions of the calling objects and each of its elements is computed as the of the corresponding element of the calling object by the corresponding element of the right hand side object. The dimensions of the calling objects must be the same, otherwise an error is thrown. Care must be taken when using this operator as the associations do not work in the same way as with the / operator. It is highly recommended to use parenthesis every time this operator is used. For example use it as follows:   (A|B).
-  /**
-      \param B: DMatrix object at the right hand side of the operator
-      \return Reference to a temporary DMatrix object with the result of the operation
-  */
-   DMatrix& operator |(const DMatrix& B) const;
   //! Matrix indexing. Returns a reference to the matrix element located at the position indicated by the row and column indices. Indices start from 1.
   /**
       \param row: Row index starting from 1.
@@ -1118,13 +1126,6 @@ public:
       \return Reference to a temporary DMatrix object with the result of the operation
   */
    friend DMatrix& mpow( DMatrix& A, int p );
-  //! This function multiplies a real number by a matrix
-  /**
-      \param  r is a double value
-      \param  A is a DMatrix object.
-      \return Reference to a temporary DMatrix object with the result of the operation
-  */
-   friend DMatrix& operator *(double r, const DMatrix& A);
   //! This function returns the transpose of a given matrix.
   /**
       \param  A is a DMatrix object.
@@ -1737,7 +1738,6 @@ void CholeskyDecomp(DMatrix& a, int n, DMatrix& pM);
 void CholeskySolution(const DMatrix& a, int n, const DMatrix& pM,
                          const DMatrix& bM, DMatrix& xM);
 void Hessemberg(DMatrix& a );
-DMatrix& operator- (const DMatrix& A);
 DMatrix& colon( double i1, double increment, double i2 );
 DMatrix& colon( int i1, int increment, int i2);
 DMatrix& colon( int i1, int i2 );
@@ -1745,7 +1745,6 @@ DMatrix& colon( double i1, double i2);
 DMatrix& colon( void );
 int any( const DMatrix& val );
 DMatrix& mpow( DMatrix& A, int p );
-DMatrix& operator *(double Arg, const DMatrix& A);
 DMatrix& tra(const DMatrix& A);
 DMatrix& inv(const DMatrix& A);
 DMatrix& pinv(const DMatrix& A);
@@ -1832,6 +1831,284 @@ long length(const DMatrix& A);
 void* my_calloc(size_t num, size_t size );
 
 
+// ===========================================================
+// Expression templates for elementwise arithmetic
+//
+// The elementwise operators +, -, & and |, the products and divisions
+// by scalars and the unary minus return lightweight expression objects
+// instead of temporary matrices. A compound expression such as
+//
+//      z = a*x + b*y - w;
+//
+// is evaluated in a single loop when it is assigned to a DMatrix, or
+// used to construct one, with no temporary objects for the
+// intermediate results. An expression used where a DMatrix is
+// expected is evaluated into a temporary object, as the other
+// operators and functions of the class do.
+
+
+//! Base class of the elementwise matrix expressions
+template <class E> class DMatrixExpr {
+public:
+  //! Returns the expression object
+   const E& derived() const { return static_cast<const E&>(*this); }
+  //! Gets the number of rows of the result
+   long GetNoRows() const { return derived().GetNoRows(); }
+  //! Gets the number of columns of the result
+   long GetNoCols() const { return derived().GetNoCols(); }
+  //! Evaluates the expression into a temporary DMatrix object
+  /**
+      \return Reference to a temporary DMatrix object with the result of the expression
+  */
+   DMatrix& eval() const;
+  //! Evaluates the expression into a temporary object when a DMatrix is required
+   operator DMatrix& () const { return eval(); }
+  //! Returns the k-th element of the result, starting from 1
+   double operator() (long k) const { return derived()[k-1]; }
+  //! Returns the element of the result at the given row and column, starting from 1
+   double operator() (long row, long col) const
+          { return derived()[ (col-1)*derived().GetNoRows() + row-1 ]; }
+};
+
+//! Matrix operand of an elementwise expression
+class DMatrixLeaf : public DMatrixExpr<DMatrixLeaf> {
+   const double* pr;
+   long n;
+   long m;
+public:
+   DMatrixLeaf( const DMatrix& A ): pr(A.GetConstPr()), n(A.GetNoRows()), m(A.GetNoCols()) {}
+   long GetNoRows() const { return n; }
+   long GetNoCols() const { return m; }
+   double operator[] (long i) const { return pr[i]; }
+};
+
+//! Elementwise operation between two expressions of the same dimensions
+template <class L, class R, class Op>
+class DMatrixBinary : public DMatrixExpr< DMatrixBinary<L,R,Op> > {
+   L l;
+   R r;
+public:
+   DMatrixBinary( const L& lval, const R& rval ): l(lval), r(rval) {}
+   long GetNoRows() const { return l.GetNoRows(); }
+   long GetNoCols() const { return l.GetNoCols(); }
+   double operator[] (long i) const { return Op::apply( l[i], r[i] ); }
+};
+
+//! Elementwise operation between an expression and a scalar
+template <class E, class Op>
+class DMatrixScalar : public DMatrixExpr< DMatrixScalar<E,Op> > {
+   E e;
+   double s;
+public:
+   DMatrixScalar( const E& eexpr, double sval ): e(eexpr), s(sval) {}
+   long GetNoRows() const { return e.GetNoRows(); }
+   long GetNoCols() const { return e.GetNoCols(); }
+   double operator[] (long i) const { return Op::apply( e[i], s ); }
+};
+
+// Elementwise operations
+struct DMatrixAdd { static double apply( double x, double y ) { return x + y; } };
+struct DMatrixSub { static double apply( double x, double y ) { return x - y; } };
+struct DMatrixMul { static double apply( double x, double y ) { return x * y; } };
+struct DMatrixDiv { static double apply( double x, double y ) { return x / y; } };
+struct DMatrixNeg { static double apply( double x, double   ) { return -x;    } };
+
+template <class Op, class L, class R>
+inline DMatrixBinary<L,R,Op> DMatrixMakeBinary( const L& l, const R& r, const char* msg )
+{
+   if ( l.GetNoRows() != r.GetNoRows() || l.GetNoCols() != r.GetNoCols() ) {
+      error_message( msg );
+   }
+   return DMatrixBinary<L,R,Op>( l, r );
+}
+
+template <class E>
+inline void DMatrixEvaluate( double* pr, const DMatrixExpr<E>& expr )
+{
+// Evaluates an expression into the array pr in a single loop
+   const E x = expr.derived();
+   long nelem = x.GetNoRows()*x.GetNoCols();
+   for ( long i=0; i< nelem; i++ ) {
+      pr[i] = x[i];
+   }
+}
+
+// Declares the elementwise operator OP for all combinations of
+// matrix and expression operands
+#define DMATRIX_ELEMENTWISE_OPERATOR( OP, OPCLASS, MSG )                              \
+inline DMatrixBinary<DMatrixLeaf,DMatrixLeaf,OPCLASS>                                  \
+operator OP ( const DMatrix& A, const DMatrix& B )                                     \
+{ return DMatrixMakeBinary<OPCLASS>( DMatrixLeaf(A), DMatrixLeaf(B), MSG ); }          \
+template <class E> inline DMatrixBinary<E,DMatrixLeaf,OPCLASS>                         \
+operator OP ( const DMatrixExpr<E>& A, const DMatrix& B )                              \
+{ return DMatrixMakeBinary<OPCLASS>( A.derived(), DMatrixLeaf(B), MSG ); }             \
+template <class E> inline DMatrixBinary<DMatrixLeaf,E,OPCLASS>                         \
+operator OP ( const DMatrix& A, const DMatrixExpr<E>& B )                              \
+{ return DMatrixMakeBinary<OPCLASS>( DMatrixLeaf(A), B.derived(), MSG ); }             \
+template <class E1, class E2> inline DMatrixBinary<E1,E2,OPCLASS>                      \
+operator OP ( const DMatrixExpr<E1>& A, const DMatrixExpr<E2>& B )                     \
+{ return DMatrixMakeBinary<OPCLASS>( A.derived(), B.derived(), MSG ); }
+
+//! Matrix addition operator. The sizes of the matrices being added should be the same, otherwise an error is thrown.
+DMATRIX_ELEMENTWISE_OPERATOR( +, DMatrixAdd, "Incoherent matrix dimensions in addition" )
+//! Matrix subtraction operator. The sizes of the matrices being subtracted should be the same, otherwise an error is thrown.
+DMATRIX_ELEMENTWISE_OPERATOR( -, DMatrixSub, "Incoherent matrix dimensions in substraction" )
+//! Elementwise product operator. The dimensions of the operands must be the same, otherwise an error is thrown. It is highly recommended to use parenthesis every time this operator is used, as in (A&B).
+DMATRIX_ELEMENTWISE_OPERATOR( &, DMatrixMul, "Dimension error in elemProduct()" )
+//! Elementwise division operator. The dimensions of the operands must be the same, otherwise an error is thrown. It is highly recommended to use parenthesis every time this operator is used, as in (A|B).
+DMATRIX_ELEMENTWISE_OPERATOR( |, DMatrixDiv, "Dimension error in elemDivision()" )
+
+#undef DMATRIX_ELEMENTWISE_OPERATOR
+
+// Declares the operator OP between an expression or a matrix and a scalar
+#define DMATRIX_SCALAR_OPERATOR( OP, OPCLASS )                                        \
+inline DMatrixScalar<DMatrixLeaf,OPCLASS> operator OP ( const DMatrix& A, double x )   \
+{ return DMatrixScalar<DMatrixLeaf,OPCLASS>( DMatrixLeaf(A), x ); }                    \
+template <class E> inline DMatrixScalar<E,OPCLASS>                                     \
+operator OP ( const DMatrixExpr<E>& A, double x )                                      \
+{ return DMatrixScalar<E,OPCLASS>( A.derived(), x ); }
+
+//! Adds a scalar real value to each element of the matrix.
+DMATRIX_SCALAR_OPERATOR( +, DMatrixAdd )
+//! Subtracts a scalar real value from each element of the matrix.
+DMATRIX_SCALAR_OPERATOR( -, DMatrixSub )
+//! Computes the product of a matrix (left hand side of the operator) times a real scalar (right hand side value).
+DMATRIX_SCALAR_OPERATOR( *, DMatrixMul )
+//! Computes the division of a matrix (left hand side of the operator) by a real scalar (right hand side value).
+DMATRIX_SCALAR_OPERATOR( /, DMatrixDiv )
+
+#undef DMATRIX_SCALAR_OPERATOR
+
+//! This function multiplies a real number by a matrix
+inline DMatrixScalar<DMatrixLeaf,DMatrixMul> operator* ( double x, const DMatrix& A )
+{ return DMatrixScalar<DMatrixLeaf,DMatrixMul>( DMatrixLeaf(A), x ); }
+template <class E> inline DMatrixScalar<E,DMatrixMul> operator* ( double x, const DMatrixExpr<E>& A )
+{ return DMatrixScalar<E,DMatrixMul>( A.derived(), x ); }
+
+//! Matrix unary minus operator. Returns an object of the same dimensions as A but with changed element signs.
+inline DMatrixScalar<DMatrixLeaf,DMatrixNeg> operator- ( const DMatrix& A )
+{ return DMatrixScalar<DMatrixLeaf,DMatrixNeg>( DMatrixLeaf(A), 0.0 ); }
+template <class E> inline DMatrixScalar<E,DMatrixNeg> operator- ( const DMatrixExpr<E>& A )
+{ return DMatrixScalar<E,DMatrixNeg>( A.derived(), 0.0 ); }
+
+// The remaining DMatrix operators are members of the class, so an
+// expression at their left hand side is evaluated into a temporary first
+#define DMATRIX_EXPR_MEMBER_OPERATOR( OP, ARG )                                       \
+template <class E> inline DMatrix& operator OP ( const DMatrixExpr<E>& A, ARG B )      \
+{ return A.eval() OP B; }
+
+DMATRIX_EXPR_MEMBER_OPERATOR( *,  const DMatrix& )
+DMATRIX_EXPR_MEMBER_OPERATOR( /,  const DMatrix& )
+DMATRIX_EXPR_MEMBER_OPERATOR( %,  const DMatrix& )
+DMATRIX_EXPR_MEMBER_OPERATOR( ||, const DMatrix& )
+DMATRIX_EXPR_MEMBER_OPERATOR( &&, const DMatrix& )
+DMATRIX_EXPR_MEMBER_OPERATOR( ^,  double )
+DMATRIX_EXPR_MEMBER_OPERATOR( >,  double )
+DMATRIX_EXPR_MEMBER_OPERATOR( <,  double )
+DMATRIX_EXPR_MEMBER_OPERATOR( >=, double )
+DMATRIX_EXPR_MEMBER_OPERATOR( <=, double )
+DMATRIX_EXPR_MEMBER_OPERATOR( ==, double )
+DMATRIX_EXPR_MEMBER_OPERATOR( !=, double )
+DMATRIX_EXPR_MEMBER_OPERATOR( >,  const DMatrix& )
+DMATRIX_EXPR_MEMBER_OPERATOR( <,  const DMatrix& )
+DMATRIX_EXPR_MEMBER_OPERATOR( >=, const DMatrix& )
+DMATRIX_EXPR_MEMBER_OPERATOR( <=, const DMatrix& )
+DMATRIX_EXPR_MEMBER_OPERATOR( ==, const DMatrix& )
+DMATRIX_EXPR_MEMBER_OPERATOR( !=, const DMatrix& )
+
+#undef DMATRIX_EXPR_MEMBER_OPERATOR
+
+template <class E>
+DMatrix& DMatrixExpr<E>::eval() const
+{
+   DMatrix* Temp;
+
+   Temp = DMatrix::GetTempPr( DMatrix::IncrementAuxIndx() );
+
+   Temp->Resize( GetNoRows(), GetNoCols() );
+
+   DMatrixEvaluate( Temp->GetPr(), *this );
+
+   return *Temp;
+}
+
+template <class L, class R, class Op>
+DMatrix::DMatrix( const DMatrixBinary<L,R,Op>& expr )
+{
+   initVars();
+   Resize( expr.GetNoRows(), expr.GetNoCols() );
+   DMatrixEvaluate( a, expr );
+   if( !DMatrix::GetMemberFlag() ) DMatrix::SetAuxIndx( -1 );
+}
+
+template <class E, class Op>
+DMatrix::DMatrix( const DMatrixScalar<E,Op>& expr )
+{
+   initVars();
+   Resize( expr.GetNoRows(), expr.GetNoCols() );
+   DMatrixEvaluate( a, expr );
+   if( !DMatrix::GetMemberFlag() ) DMatrix::SetAuxIndx( -1 );
+}
+
+template <class E>
+DMatrix& DMatrix::operator= (const DMatrixExpr<E>& expr)
+{
+// Assignment of an elementwise expression, the operands are read
+// elementwise so the calling object may also appear in the expression
+   if ( GetMType() == 1 ) {
+      return AssignmentToColonReference( expr.eval() );
+   }
+
+   if ( n != expr.GetNoRows() || m != expr.GetNoCols() ) {
+      Resize( expr.GetNoRows(), expr.GetNoCols() );
+   }
+
+   DMatrixEvaluate( a, expr );
+
+   if( !DMatrix::GetMemberFlag() ) DMatrix::SetAuxIndx( -1 );
+
+   return *this;
+}
+
+template <class E>
+DMatrix& DMatrix::operator+= (const DMatrixExpr<E>& expr)
+{
+   const E x = expr.derived();
+   long nelem = n*m;
+
+   if ( m != x.GetNoCols() || n != x.GetNoRows() ) {
+      error_message("Bad dimensions in DMatrix op. +=");
+   }
+
+   for ( long i=0; i< nelem; i++ ) {
+      a[i] += x[i];
+   }
+
+   if( !DMatrix::GetMemberFlag() ) DMatrix::SetAuxIndx( -1 );
+
+   return *this;
+}
+
+template <class E>
+DMatrix& DMatrix::operator-= (const DMatrixExpr<E>& expr)
+{
+   const E x = expr.derived();
+   long nelem = n*m;
+
+   if ( m != x.GetNoCols() || n != x.GetNoRows() ) {
+      error_message("Bad dimensions in DMatrix op. -=");
+   }
+
+   for ( long i=0; i< nelem; i++ ) {
+      a[i] -= x[i];
+   }
+
+   if( !DMatrix::GetMemberFlag() ) DMatrix::SetAuxIndx( -1 );
+
+   return *this;
+}
+
+
 // ===========================================================
 
 
@@ -1892,6 +2169,19 @@ int dgelss_(integer *m, integer *n, integer *nrhs,
 int dgelqf_(integer *m, integer *n, doublereal *a, integer *
         lda, doublereal *tau, doublereal *work, integer *lwork, integer *info);
 
+  /* BLAS matrix-matrix product routine */
+
+int dgemm_(char *transa, char *transb, integer *m, integer *n,
+	integer *k, doublereal *alpha, doublereal *a, integer *lda,
+	doublereal *b, integer *ldb, doublereal *beta, doublereal *c,
+	integer *ldc);
+
+  /* BLAS matrix-vector product routine */
+
+int dgemv_(char *trans, integer *m, integer *n, doublereal *alpha,
+	doublereal *a, integer *lda, doublereal *x, integer *incx,
+	doublereal *beta, doublereal *y, integer *incy);
+
 
 
 
@@ -132,22 +132,43 @@ extern "C" {
 
 DMatrix*  DMatrix::GetTempPr(int i) {
 
+   if ( i >= noAuxArr ) DMatrix::ExpandAuxArr( i+1 );
 
-   auxPr[i].mtype = 0;
-   auxPr[i].mt    = NULL;
-   auxPr[i].rowIndx = NULL;
-   auxPr[i].colIndx = NULL;
-   return &auxPr[i];
+   auxPr[i]->mtype = 0;
+   auxPr[i]->mt    = NULL;
+   auxPr[i]->rowIndx = NULL;
+   auxPr[i]->colIndx = NULL;
+   return auxPr[i];
 
 }
 
-inline long ChkTmpIndx( long taindx )
+void DMatrix::ExpandAuxArr( int nn )
 {
+// Enlarges the table of temporary objects. The objects are allocated
+// individually so that references to existing temporaries remain valid
+
+   int i;
+
+   int nnew = MAX( nn, MAX( 2*noAuxArr, N_TEMP_OBJECTS ) );
+
+   DMatrix** table = (DMatrix**) realloc( auxPr, nnew*sizeof(DMatrix*) );
+
+   if (!table) ERROR_MESSAGE("allocation failure in DMatrix::ExpandAuxArr()");
 
+   auxPr = table;
 
-   if ( taindx >= N_TEMP_OBJECTS )
+   for ( i = noAuxArr; i < nnew; i++ )
+   {
+      auxPr[i] = new DMatrix;
+      auxPr[i]->auxFlag = 1;
+   }
+
+   noAuxArr = nnew;
 
-     ERROR_MESSAGE(" Temporary arrays error: Increase N_TEMP_OBJECTS");
+}
+
+inline long ChkTmpIndx( long taindx )
+{
 
 #ifdef DEBUG_TEMPS
 
@@ -165,13 +186,11 @@ inline long ChkTmpIndx( long taindx )
 /* Definition of static member variables of class DMatrix */
 
 
-DEC_THREAD DMatrix* DMatrix::auxPr = NULL;        // Pointer to auxiliary arrays
+DEC_THREAD DMatrix** DMatrix::auxPr = NULL;       // Table of auxiliary arrays
 
 DEC_THREAD int   DMatrix::initFlag = 0;           // To be allocated in AllocateAuxArr() */
 
-DEC_THREAD int   DMatrix::noAuxArr=N_TEMP_OBJECTS;// Number of auxiliary arrays
-
-DEC_THREAD long  DMatrix::dimAux=D_TEMP_OBJECTS;  // Dimension of auxiliary arrays
+DEC_THREAD int   DMatrix::noAuxArr = 0;           // Number of auxiliary arrays
 
 DEC_THREAD int   DMatrix::auxIndx=-1;             // Index of used auxiliary arrays
 
@@ -197,13 +216,6 @@ long generate_seed(time_t *timer);
 DEC_THREAD int  DMatrix::stream        = 0;                    // stream index
 
 
-#ifdef OTISS_CASE
-
-DEC_THREAD double DMatrix::axp[N_TEMP_OBJECTS][D_TEMP_OBJECTS];
-
-#endif
-
-
 char* num2str(double num);
 
 long generate_seed(time_t *timer)
@@ -467,6 +479,74 @@ DMatrix::DMatrix( const DMatrix& A)
 
 }
 
+#ifdef DMATRIX_MOVE_SEMANTICS
+DMatrix::DMatrix( DMatrix&& A )
+// move constructor
+{
+
+  initVars();
+
+  if ( A.atype==0 ) {
+
+     TakeStorage( A );
+
+  }
+
+  else {
+
+     n=A.n;
+
+     m=A.m;
+
+     asize = n*m;
+
+     DMatrix::Allocate(asize);
+
+     memcpy( a, A.a , n*m*sizeof(double) );
+
+  }
+
+  SetReferencedDMatrixPointer( NULL );
+  SetRowIndexPointer(NULL);
+  SetColIndexPointer(NULL);
+  SetMType(0);
+
+  if( !DMatrix::GetMemberFlag() ) DMatrix::SetAuxIndx( -1 );
+
+}
+#endif
+
+void DMatrix::TakeStorage( DMatrix& A )
+{
+// Takes over the storage of A. A temporary A receives the previous
+// storage of the calling object for reuse, otherwise it is freed
+
+   double* olda    = allocated ? a : NULL;
+   long    oldsize = allocated ? asize : 0;
+
+   a         = A.a;
+   asize     = A.asize;
+   allocated = A.allocated;
+   n         = A.n;
+   m         = A.m;
+
+   if ( A.auxFlag==1 ) {
+      A.a         = olda;
+      A.asize     = oldsize;
+      A.allocated = ( olda!=NULL );
+   }
+   else {
+      if ( olda!=NULL ) mxFree( olda );
+      A.a         = NULL;
+      A.asize     = 0;
+      A.allocated = false;
+   }
+
+   A.n = 0;
+   A.m = 0;
+
+}
+
 void DMatrix::PrintInfo(const char *str) const
 {
     fprintf(stderr,"\nInformation about DMatrix object: %s", str);
@@ -499,25 +579,9 @@ void DMatrix::AllocateAuxArr( void )
 
    if (DMatrix::GetInitFlag()==0 ) {
 
-    *(DMatrix::GetAuxPr()) = (DMatrix*) my_calloc( N_TEMP_OBJECTS , sizeof(DMatrix) );
-
-    for (i =0; i< GetNoAuxArr(); i++ )
-    {
-
-#ifdef DECLARED_TEMPS
-
-      DMatrix::auxPr[i].a = axp[i];
-      DMatrix::auxPr[i].atype = 1;
-
-
-
-#endif /* DECLARED_TEMPS */
-
-      DMatrix::auxPr[i].Resize(GetDimAux(), 1 );
-	  DMatrix::auxPr[i].auxFlag = 1;
-	  DMatrix::auxPr[i].asize = GetDimAux();
+    // The temporaries start empty, their storage is allocated by Resize()
 
-    }
+    DMatrix::ExpandAuxArr( N_TEMP_OBJECTS );
 
     DMatrix::SetInitFlag( 1 );
 
@@ -540,13 +604,19 @@ void DMatrix::DeAllocateAuxArr( void )
     for ( i=0; i< GetNoAuxArr(); i++ )
     {
 
-       DMatrix::auxPr[i].~DMatrix();
+       if (DMatrix::auxPr[i]->allocated) mxFree( DMatrix::auxPr[i]->a );
 
-    }
+       DMatrix::auxPr[i]->a = NULL;
+
+       delete DMatrix::auxPr[i];
 
+    }
 
+    mxFree( DMatrix::auxPr );
 
-    mxFree( *(DMatrix::GetAuxPr()) );
+    DMatrix::auxPr    = NULL;
+    DMatrix::noAuxArr = 0;
+    DMatrix::SetInitFlag( 0 );
 
 
 }
@@ -645,16 +715,35 @@ void DMatrix::Resize( long nnrow, long nncol )
 
    if ( a!=NULL && auxFlag==1 ) {
 
-	   if (nnrow*nncol <= dimAux )
+	   // Temporaries keep their storage between uses and only grow it
+	   // when a larger result is needed
+
+	   if (nnrow*nncol > asize )
 	   {
-		  n = nnrow;
-		  m = nncol;
-	   }
+		  long newsize = MAX( nnrow*nncol, 2*asize );
 
-	   else {
-			ERROR_MESSAGE("\nError resizing Temporary array in DMatrix::Resize()");
+		  double* atemp = (double *) my_calloc( newsize, sizeof(double) );
+
+		  if (!atemp) {
+		     ERROR_MESSAGE("\nError resizing Temporary array in DMatrix::Resize()");
+		  }
+
+		  memcpy( atemp, a, asize*sizeof(double) );
+
+		  if (allocated) mxFree( a );
+
+		  a = atemp;
+
+		  asize = newsize;
+
+		  allocated = true;
 	   }
 
+	   n = nnrow;
+	   m = nncol;
+
+	   return;
+
    }
 
 
@@ -1039,101 +1128,6 @@ ErrorHandler::ErrorHandler(const string m)
   error_message = m;
 }
 
-DMatrix& DMatrix::operator+ (const DMatrix& Other_matrix) const
-{
-// Matrix addition operator: Adds two matrices
-// Example C = D + E; where C,D,E are DMatrix objects
-
-  long i;
-
-  const double* OtherPr = Other_matrix.GetConstPr();
-
-  DMatrix* Temp;
-
-  long nelem = n*m;
-
-  if (m != Other_matrix.m || n != Other_matrix.n)
-
-  { ERROR_MESSAGE("Incoherent matrix dimensions in addition"); }
-
-
-  Temp = DMatrix::GetTempPr(ChkTmpIndx(DMatrix::IncrementAuxIndx()));
-
-  Temp->Resize( n, m );
-
-
-  for (i=0; i< nelem; i++)
-  {
-
-     Temp->GetPr()[i] = a[i] + OtherPr[i];
-
-  }
-
-  return *Temp;
-
-}
-
-
-DMatrix& DMatrix::operator+ (double arg) const
-{
-// Matrix  + scalar operator: Adds scalar to each element of the matrix.
-// Example C = D + f; where C,D are DMatrix objects and f is a double
-
-  long i;
-
-
-  DMatrix* Temp;
-
-  long nelem = n*m;
-
-  Temp = DMatrix::GetTempPr(ChkTmpIndx(DMatrix::IncrementAuxIndx()));
-
-  Temp->Resize( n, m );
-
-
-  for (i=0; i< nelem; i++)
-  {
-
-     Temp->GetPr()[i] = a[i] + arg;
-
-  }
-
-  return *Temp;
-
-}
-
-DMatrix& DMatrix::operator- (double arg) const
-{
-// Matrix  - scalar operator: Subtracts scalar to each element of the matrix.
-// Example C = D - f; where C,D are DMatrix objects and f is a double
-
-  long i;
-
-
-
-  DMatrix* Temp;
-
-  long nelem = n*m;
-
-  Temp = DMatrix::GetTempPr(ChkTmpIndx(DMatrix::IncrementAuxIndx()));
-
-  Temp->Resize( n, m );
-
-
-  for (i=0; i< nelem; i++)
-  {
-
-     Temp->GetPr()[i] = a[i] - arg;
-
-  }
-
-  return *Temp;
-
-}
-
-
-
-
 DMatrix& DMatrix::operator += (const DMatrix &rval)
 {
 // Matrix addition with substitution
@@ -1164,37 +1158,6 @@ DMatrix& DMatrix::operator += (const DMatrix &rval)
 
 
 
-DMatrix& DMatrix::operator- (const DMatrix& Other_matrix) const
-{
-// Matrix substraction operator: substracts two matrices
-// Example C = D - E; where C,D,E are DMatrix objects
-
-  long i;
-
-  long nelem = n*m;
-
-  const double *OtherPr = Other_matrix.GetConstPr();
-
-  DMatrix* Temp;
-
-  if (m != Other_matrix.m || n != Other_matrix.n)
-
-  { ERROR_MESSAGE("Incoherent matrix dimensions in substraction"); }
-
-  Temp = DMatrix::GetTempPr(ChkTmpIndx(DMatrix::IncrementAuxIndx()));
-
-  Temp->Resize( n, m );
-
-  for (i=0; i< nelem; i++)
-  {
-
-     Temp->GetPr()[i] = a[i] - OtherPr[i];
-
-  }
-
-  return *Temp;
-}
-
 DMatrix& DMatrix::operator -= (const DMatrix &rval)
 {
 // Matrix substraction with substitution
@@ -1223,35 +1186,54 @@ DMatrix& DMatrix::operator -= (const DMatrix &rval)
 }
 
 
-DMatrix& operator- (const DMatrix& A)
+#ifdef LAPACK
+
+static int use_blas_product(long n, long m, long k)
 {
-// Matrix unary minus operator
-// Eg. C =  -A;
+// Small products are computed inline, as the overhead of calling BLAS dominates
 
+  return ( n>0 && m>0 && k>0 && ((double) n)*((double) m)*((double) k) >= BLAS_PRODUCT_THRESHOLD );
 
-  long nelem = A.GetNoRows()*A.GetNoCols();
-  const double *Apr = A.GetConstPr();
-  DMatrix* Temp;
-
+}
 
+static void blas_product(char transa, char transb, const DMatrix& A, const DMatrix& B, DMatrix& C)
+{
+// Computes C = op(A)*op(B), where op(X) is X or tra(X), using dgemv if
+// C is a column vector and dgemm otherwise. C must be already sized.
 
+  integer nrows = C.GetNoRows();
+  integer ncols = C.GetNoCols();
+  integer lda   = A.GetNoRows();
+  integer ldb   = B.GetNoRows();
+  integer ldc   = nrows;
+  integer k     = ( transa=='N' ) ? A.GetNoCols() : A.GetNoRows();
 
-  Temp = DMatrix::GetTempPr(ChkTmpIndx(DMatrix::IncrementAuxIndx()));
+  doublereal alpha = 1.0;
+  doublereal beta  = 0.0;
 
-  Temp->Resize( A.GetNoRows(), A.GetNoCols() );
+  if ( ncols == 1 ) {
 
+      // op(B) is a column vector stored contiguously in either case
 
-  for(long i=0; i< nelem; i++)
-  {
+      integer arows = A.GetNoRows();
+      integer acols = A.GetNoCols();
+      integer inc   = 1;
 
-     Temp->GetPr()[i] = -Apr[i];
+      dgemv_(&transa, &arows, &acols, &alpha, A.GetConstPr(), &lda,
+             B.GetConstPr(), &inc, &beta, C.GetPr(), &inc);
 
   }
 
-  return *Temp;
+  else {
+
+      dgemm_(&transa, &transb, &nrows, &ncols, &k, &alpha, A.GetConstPr(), &lda,
+             B.GetConstPr(), &ldb, &beta, C.GetPr(), &ldc);
+
+  }
 
 }
 
+#endif /* LAPACK */
 
 
 DMatrix& DMatrix::operator* (const DMatrix& B) const
@@ -1294,6 +1276,13 @@ DMatrix& Product(const DMatrix& A, const DMatrix& B)
 
   Temp->Resize( A.n, mb );
 
+#ifdef LAPACK
+  if ( use_blas_product(na, mb, nb) ) {
+      blas_product('N', 'N', A, B, *Temp);
+      return *Temp;
+  }
+#endif
+
   for (i=0; i< na; i++)
   {
 
@@ -1425,36 +1414,6 @@ DMatrix& DMatrix::operator*= (const DMatrix& Other_matrix)
 
 
 
-DMatrix& DMatrix::operator* (double Arg) const
-{
-// Matrix by scalar product.
-// Eg. C = A*x, where C & A are DMatrix objects and x is a double
-  long i;
-
-  long nelem = n*m;
-
-  DMatrix* Temp;
-
-  double *pr;
-
-  Temp = DMatrix::GetTempPr(ChkTmpIndx(DMatrix::IncrementAuxIndx()));
-
-  Temp->Resize( n, m );
-
-  pr = Temp->GetPr();
-
-  for( i=0; i< nelem; i++ )
-  {
-
-     pr[i] = a[i]*Arg;
-
-  }
-
-  return *Temp;
-
-}
-
-
 DMatrix& DMatrix::operator*= (double Arg)
 {
 // Matrix by scalar product with substitution
@@ -1501,37 +1460,6 @@ DMatrix& DMatrix::operator/ (const DMatrix& rval) const
 }
 
 
-DMatrix& DMatrix::operator/ (double Arg) const
-{
-// Matrix scalar division.
-// Eg. C = A/x, where C & A are DMatrix objects and x is a double
-
-  long i;
-
-  long nelem = n*m;
-
-  DMatrix* Temp;
-
-  double *pr;
-
-  Temp = DMatrix::GetTempPr(ChkTmpIndx(DMatrix::IncrementAuxIndx()));
-
-  Temp->Resize( n, m );
-
-  pr = Temp->GetPr();
-
-  for( i=0; i< nelem; i++ )
-  {
-
-     pr[i] = a[i]/Arg;
-
-  }
-
-  return *Temp;
-
-}
-
-
 DMatrix& DMatrix::operator/= (double Arg)
 {
 // Matrix by scalar division with substitution
@@ -1554,46 +1482,6 @@ DMatrix& DMatrix::operator/= (double Arg)
 }
 
 
-DMatrix& operator *(double Arg, const DMatrix& A)
-{
-// Scalar by Matrix product.
-// Eg. C = x*A, where C & A are DMatrix objects and x is a double
-
-
-  long i,n,m,nelem;
-
-  const double * Apr = A.GetConstPr();
-
-  n=A.GetNoRows();
-
-  m=A.GetNoCols();
-
-  nelem = n*m;
-
-  DMatrix* Temp;
-
-  double *pr;
-
-
-  Temp = DMatrix::GetTempPr(ChkTmpIndx(DMatrix::IncrementAuxIndx()));
-
-  Temp->Resize( n, m );
-
-  pr   = Temp->GetPr();
-
-
-  for (i=0; i< nelem; i++ )
-  {
-
-     pr[i] = Apr[i]*Arg;
-
-  }
-
-  return *Temp;
-
-}
-
-
 DMatrix& DMatrix::operator <  ( double val ) const
 {
 // Relational < operator
@@ -2101,6 +1989,13 @@ DMatrix& TProduct(const DMatrix& A, const DMatrix& B)
 
   Temp->Resize( A.m, mb );
 
+#ifdef LAPACK
+  if ( use_blas_product(na, mb, nb) ) {
+      blas_product('T', 'N', A, B, *Temp);
+      return *Temp;
+  }
+#endif
+
   for (i=1; i<=na; i++)
   {
 
@@ -2153,6 +2048,13 @@ DMatrix& ProductT(const DMatrix& A, const DMatrix& B)
 
   Temp->Resize( A.n, mb );
 
+#ifdef LAPACK
+  if ( use_blas_product(na, mb, nb) ) {
+      blas_product('N', 'T', A, B, *Temp);
+      return *Temp;
+  }
+#endif
+
   for (i=1; i<=na; i++)
   {
 
@@ -2205,6 +2107,13 @@ DMatrix& TProductT(const DMatrix& A, const DMatrix& B)
 
   Temp->Resize( A.m, B.n );
 
+#ifdef LAPACK
+  if ( use_blas_product(A.m, B.n, A.n) ) {
+      blas_product('T', 'T', A, B, *Temp);
+      return *Temp;
+  }
+#endif
+
   for (i=0; i< A.m; i++)
   {
 
@@ -2348,12 +2257,18 @@ DMatrix& DMatrix::operator= (const DMatrix& Other_matrix)
 
   }
 
+  else if (auxFlag==1) {
+
+         this->Resize(Other_matrix.n,Other_matrix.m);
+
+  }
+
   else {
 
          n = Other_matrix.n;
 
          m = Other_matrix.m;
-         if (atype==0 && auxFlag!=1)
+         if (atype==0)
            DMatrix::Allocate(n*m);
 
   }
@@ -2368,6 +2283,28 @@ DMatrix& DMatrix::operator= (const DMatrix& Other_matrix)
 
 }
 
+#ifdef DMATRIX_MOVE_SEMANTICS
+DMatrix& DMatrix::operator= (DMatrix&& Other_matrix)
+{
+// Matrix move assignment operator
+// Eg. A = std::move(B);
+
+ if ( GetMType()==1 || atype!=0 || auxFlag==1 || this==&Other_matrix ||
+      Other_matrix.atype!=0 ) {
+
+      return DMatrix::operator=( (const DMatrix&) Other_matrix );
+
+ }
+
+ TakeStorage( Other_matrix );
+
+ if( !DMatrix::GetMemberFlag() ) DMatrix::SetAuxIndx( -1 );
+
+ return *this;
+
+}
+#endif
+
 
 
 void DMatrix::DeAllocate()
@@ -3244,11 +3181,6 @@ double Fnorm(const DMatrix& A)  // F-norm function
 
 }
 
-DMatrix& DMatrix::operator &(const DMatrix& B) const
-{
-    return elemProduct(*this,B);
-}
-
 DMatrix& elemProduct( const DMatrix& A, const DMatrix& B )
 {
 
@@ -3276,12 +3208,6 @@ DMatrix& elemProduct( const DMatrix& A, const DMatrix& B )
 
 }
 
-DMatrix& DMatrix::operator |(const DMatrix& B) const
-{
-    return elemDivision(*this,B);
-}
-
-
 DMatrix& elemDivision( const DMatrix& A, const DMatrix& B )
 {
 
@@ -4060,6 +3986,46 @@ void DMatrix::Load(const char * FileName )
 }
 
 
+void DMatrix::UseExternalArray( long vDim, double* v, long Initn, long Initm )
+// Makes the matrix use a pre-allocated array (e.g. a memory mapped file) as storage
+{
+
+   if ( atype==0 && auxFlag!=1 && a!=NULL )
+   {
+      DMatrix::DeAllocate();
+   }
+
+   if ( v==NULL )
+   {
+      a = NULL;
+      n = 0;
+      m = 0;
+      asize = 0;
+      atype = 0;
+      allocated = false;
+      return;
+   }
+
+   if ( Initm<0 || Initn<0 ) {
+
+      ERROR_MESSAGE("Attempt to use a negative dimension in DMatrix::UseExternalArray()");
+   }
+
+   if ( Initn*Initm > vDim ) {
+
+      ERROR_MESSAGE("Error in DMatrix::UseExternalArray(): array is too short for the requested dimensions");
+   }
+
+   a = v;
+   n = Initn;
+   m = Initm;
+   asize = vDim;
+   atype = 1;
+   allocated = false;
+
+}
+
+
 void DMatrix::Fprint( FILE *fp )
 {
 
@@ -4710,6 +4676,7 @@ DMatrix& LUFSolve( const DMatrix& ALU, const DMatrix &b )
 
 
      xx->  Resize( nn , 1 );
+     indx->Resize( nn , 1 );
      rr->  Resize( nn, b.GetNoCols() );
 
      for ( i = 1; i<= nn; i++ ) {
@@ -5697,6 +5664,7 @@ DMatrix& SVD( const DMatrix& A, DMatrix* U, DMatrix* V  )
      integer LDVT = N;
      integer LWORK;
      integer INFO;
+     double  WKOPT;
 
      int nrows = A.GetNoRows();
      int ncols = A.GetNoCols();
@@ -5754,8 +5722,17 @@ DMatrix& SVD( const DMatrix& A, DMatrix* U, DMatrix* V  )
      memcpy( a->a, A.a, A.n*A.m*sizeof(double) );
 
 
-     LWORK = DMatrix::GetDimAux();
+     // Workspace query
+
+     LWORK = -1;
+
+     dgesvd_( &JOBU, &JOBVT, &M, &N,
+          a->GetPr(), &LDA, s->GetPr(), upr,
+          &LDU, vtpr , &LDVT, &WKOPT, &LWORK, &INFO);
+
+     LWORK = (integer) WKOPT;
 
+     wk->Resize( LWORK, 1 );
 
 /* Subroutine int dgesvd_(char *jobu, char *jobvt, integer *m, integer *n,
         doublereal *a, integer *lda, doublereal *s, doublereal *u, integer *
@@ -6085,6 +6062,8 @@ DMatrix& SVDSolve( const DMatrix& A, const DMatrix& B )
 
      double  RCOND;
 
+     double  WKOPT;
+
      if (DMatrix::GetMemberFlag()) localFlag = 1;
 
      DMatrix::SetMemberFlag( 1 );
@@ -6108,13 +6087,24 @@ DMatrix& SVDSolve( const DMatrix& A, const DMatrix& B )
      xx   ->Resize( N, NRHS         );
 
      RCOND = MAX( N, M )* eps;
-     LWORK = DMatrix::GetDimAux();
 
 
      memcpy( aa->a, A.a, A.n*A.m*sizeof(double)  );
 
      memcpy( bb->a, B.a, B.n*B.m*sizeof(double ) );
 
+     // Workspace query
+
+     LWORK = -1;
+
+	 dgelss_( &M, &N, &NRHS, aa->a, &LDA, bb->a, &LDB, ww->a,
+
+	          &RCOND, &RANK, &WKOPT, &LWORK, &INFO );
+
+     LWORK = (integer) WKOPT;
+
+     wk   ->Resize( LWORK, 1     );
+
 
 	 dgelss_( &M, &N, &NRHS, aa->a, &LDA, bb->a, &LDB, ww->a,
 
@@ -6153,8 +6143,9 @@ DMatrix& schur( const DMatrix& A, DMatrix* U  )
      integer LDA = A.GetNoRows();
      integer SDIM = 0;
      integer LDVS = N;
-     integer LWORK = DMatrix::GetDimAux();
+     integer LWORK;
      integer INFO;
+     double  WKOPT;
 
      DMatrix * a;
      DMatrix * wr;
@@ -6195,6 +6186,18 @@ DMatrix& schur( const DMatrix& A, DMatrix* U  )
 
      memcpy( a->a, A.a, A.n*A.m*sizeof(double) );
 
+     // Workspace query
+
+      LWORK = -1;
+
+      dgees_(&JOBVS, &SORT, NULL, &N,
+        a->GetPr() , &LDA, &SDIM, wr->GetPr(),
+        wi->GetPr(), vs   , &LDVS, &WKOPT,
+        &LWORK, NULL, &INFO);
+
+      LWORK = (integer) WKOPT;
+
+      wk  ->Resize( LWORK, 1 );
 
       dgees_(&JOBVS, &SORT, NULL, &N,
         a->GetPr() , &LDA, &SDIM, wr->GetPr(),
@@ -6228,8 +6231,9 @@ DMatrix& LSMNSolve( const DMatrix& A, const DMatrix& B  )
      integer NRHS = B.GetNoCols();
      integer LDA =  M;
      integer LDB;
-     integer LWORK = DMatrix::GetDimAux();
+     integer LWORK;
      integer INFO;
+     double  WKOPT;
 
      integer MN = MAX( M, N );
 
@@ -6253,7 +6257,17 @@ DMatrix& LSMNSolve( const DMatrix& A, const DMatrix& B  )
 
      b->SetSubMatrix( 1,1, B );
 
+     // Workspace query
+
+     LWORK = -1;
+
+     dgels_(&TRANS, &M, &N,
+        &NRHS, a->GetPr(), &LDA, b->GetPr(), &LDB,
+        &WKOPT, &LWORK, &INFO );
+
+     LWORK = (integer) WKOPT;
 
+     wk  ->Resize( LWORK, 1 );
 
      dgels_(&TRANS, &M, &N,
         &NRHS, a->GetPr(), &LDA, b->GetPr(), &LDB,
@@ -6338,7 +6352,7 @@ DMatrix& eig( const DMatrix & A, DMatrix* V  )
    integer N   = nn;
    integer LDVL = nn;
    integer LDVR = nn;
-   integer LWORK = DMatrix::GetDimAux();
+   integer LWORK = 5*nn;
    double   VL;
    double* vpr;
 
@@ -6365,6 +6379,7 @@ DMatrix& eig( const DMatrix & A, DMatrix* V  )
 
    else {
      vx  = DMatrix::GetTempPr(ChkTmpIndx(DMatrix::IncrementAuxIndx()));
+     vx  ->Resize( nn , nn );
      vpr = vx->GetPr();
    }
 
@@ -6473,6 +6488,7 @@ double rcond( const DMatrix& A )
    ANORM = InfNorm( tra( A ) );
 
    atmp ->Resize( N, N );
+   wk   ->Resize( 4*N, 1 );
    memcpy( atmp->a, A.a, N*N*sizeof(double) );
 
    dgetrf_(&M, &N, atmp->a, &LDA, IPIV, &INFO );
@@ -6481,7 +6497,7 @@ double rcond( const DMatrix& A )
 
    if(!localFlag) DMatrix::SetMemberFlag( 0 );
 
-   delete[] IPIV;
+   mxFree( IPIV );
 
    return (RCOND);
 